@@ -0,0 +1,200 @@
+// Сравнивает размещение массивов сущностей в обычной куче и на huge pages.
+// Для каждого режима отдельно измеряются время тика и промахи dTLB (perf_event_open).
+// Запуск: entity_memory_benchmark [игроков] [тиков]
+// Сбор предметов стоит O(игроков * лута), поэтому время тика растёт с числом игроков
+// быстрее линейного: уже 20 000 игроков дают тик порядка секунды.
+//
+// Чтобы сравнить ещё и глобальный malloc, соберите бенчмарк с -DGAME_SERVER_MALLOC=jemalloc
+// (mimalloc, tcmalloc) и сравните строки "heap" двух сборок.
+#include "../src/model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    using namespace std::literals;
+
+    // Счётчик промахов dTLB при чтении в текущем потоке
+    class TlbMissCounter {
+    public:
+        TlbMissCounter() {
+#ifdef __linux__
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CACHE_DTLB
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd_ = static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~TlbMissCounter() {
+#ifdef __linux__
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+#endif
+        }
+
+        TlbMissCounter(const TlbMissCounter&) = delete;
+        TlbMissCounter& operator=(const TlbMissCounter&) = delete;
+
+        bool IsAvailable() const noexcept {
+            return fd_ >= 0;
+        }
+
+        void Start() {
+#ifdef __linux__
+            if (fd_ >= 0) {
+                ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        uint64_t Stop() {
+            uint64_t count = 0;
+#ifdef __linux__
+            if (fd_ >= 0) {
+                ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+                if (::read(fd_, &count, sizeof(count)) != sizeof(count)) {
+                    count = 0;
+                }
+            }
+#endif
+            return count;
+        }
+
+    private:
+        int fd_ = -1;
+    };
+
+    constexpr int GRID_ROADS = 40;
+    constexpr double ROAD_LENGTH = 2000.0;
+    constexpr double TICK_SECONDS = 0.05;
+
+    model::Map MakeGridMap() {
+        model::Map map{ model::Map::Id{ "bench" }, "Benchmark grid" };
+        const double step = ROAD_LENGTH / (GRID_ROADS - 1);
+        for (int i = 0; i < GRID_ROADS; ++i) {
+            const double offset = i * step;
+            map.AddRoad({ model::Road::HORIZONTAL, { 0.0, offset }, ROAD_LENGTH });
+            map.AddRoad({ model::Road::VERTICAL, { offset, 0.0 }, ROAD_LENGTH });
+        }
+        for (int i = 0; i < GRID_ROADS; i += 4) {
+            map.AddOffice({ model::Office::Id{ "office" + std::to_string(i) },
+                { i * step, i * step }, { 0.0, 0.0 } });
+        }
+        map.SetDogSpeed(4.0);
+        map.SetBagCapacity(3);
+        map.SetLootTypes(boost::json::array{ boost::json::object{ { "name", "key" }, { "value", 10 } } });
+        map.SetLootTypesCount(1);
+        return map;
+    }
+
+    void SteerDog(model::Dog& dog, double speed, std::mt19937& random) {
+        switch (random() % 4) {
+        case 0: dog.SetSpeed({ speed, 0.0 }); dog.SetDirection(model::Direction::EAST); break;
+        case 1: dog.SetSpeed({ -speed, 0.0 }); dog.SetDirection(model::Direction::WEST); break;
+        case 2: dog.SetSpeed({ 0.0, speed }); dog.SetDirection(model::Direction::SOUTH); break;
+        default: dog.SetSpeed({ 0.0, -speed }); dog.SetDirection(model::Direction::NORTH); break;
+        }
+    }
+
+    void RunScenario(std::string_view name, memory::EntityMemory mode, size_t players, int ticks) {
+        memory::ConfigureEntityMemory(mode);
+
+        model::Game game;
+        game.SetDogRetirementTime(1e9);
+        game.SetLootGeneratorConfig(1.0, 0.5);
+        game.AddMap(MakeGridMap());
+
+        const auto map_id = model::Map::Id{ "bench" };
+        auto& session = game.GetOrCreateSession(map_id);
+        const auto* map = session.GetMap();
+
+        std::mt19937 random{ 42 };
+        for (size_t i = 0; i < players; ++i) {
+            model::Dog dog{ model::Dog::Id{ "dog" + std::to_string(i) }, "dog" + std::to_string(i), map_id };
+            dog.SetPosition(map->GetRandomPosition());
+            SteerDog(dog, map->GetDogSpeed(), random);
+            session.AddPlayer(model::Player{ model::Player::Id{ i }, std::move(dog),
+                Token{ std::to_string(i) }, map->GetBagCapacity() });
+        }
+
+        TlbMissCounter tlb_misses;
+        std::vector<double> tick_ms;
+        tick_ms.reserve(ticks);
+        uint64_t total_misses = 0;
+
+        for (int tick = 0; tick < ticks; ++tick) {
+            // Часть собак меняет направление, остановившиеся у края дороги снова трогаются
+            for (auto& player : session.GetPlayers()) {
+                if (random() % 10 == 0 || !player.GetDog().IsMoving()) {
+                    SteerDog(player.GetDog(), map->GetDogSpeed(), random);
+                }
+            }
+
+            tlb_misses.Start();
+            const auto start = std::chrono::steady_clock::now();
+            game.UpdateState(TICK_SECONDS);
+            const auto finish = std::chrono::steady_clock::now();
+            total_misses += tlb_misses.Stop();
+
+            tick_ms.push_back(std::chrono::duration<double, std::milli>(finish - start).count());
+        }
+
+        std::sort(tick_ms.begin(), tick_ms.end());
+        const double mean = std::accumulate(tick_ms.begin(), tick_ms.end(), 0.0) / tick_ms.size();
+        const double p99 = tick_ms[std::min(tick_ms.size() - 1, tick_ms.size() * 99 / 100)];
+
+        std::cout << std::left << std::setw(12) << name
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << mean
+            << std::setw(12) << p99;
+        if (tlb_misses.IsAvailable()) {
+            std::cout << std::setw(18) << total_misses / ticks;
+        }
+        else {
+            std::cout << std::setw(18) << "n/a";
+        }
+        std::cout << std::endl;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t players = argc > 1 ? std::stoul(argv[1]) : 20'000;
+    const int ticks = argc > 2 ? std::stoi(argv[2]) : 50;
+
+    std::cout << "players: " << players << ", ticks: " << ticks << "\n"
+        << std::left << std::setw(12) << "memory"
+        << std::right << std::setw(12) << "mean ms"
+        << std::setw(12) << "p99 ms"
+        << std::setw(18) << "dTLB misses/tick" << std::endl;
+
+    RunScenario("heap"sv, memory::EntityMemory::HEAP, players, ticks);
+    RunScenario("huge-pages"sv, memory::EntityMemory::HUGE_PAGES, players, ticks);
+    RunScenario("hugetlb"sv, memory::EntityMemory::HUGETLB, players, ticks);
+
+    return EXIT_SUCCESS;
+}
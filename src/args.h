@@ -4,6 +4,76 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <optional>
+#include <string_view>
+
+// Адрес, на котором сервер принимает соединения: TCP (host:port) или Unix-сокет
+// (unix:path или unix:path:mode, где mode - восьмеричные права на файл сокета, например 0660)
+struct ListenEndpoint {
+    std::string host;
+    unsigned short port = 0;
+    std::string unix_path;
+    std::optional<unsigned> unix_mode;
+
+    bool IsUnix() const {
+        return !unix_path.empty();
+    }
+};
+
+ListenEndpoint ParseListenEndpoint(const std::string& value) {
+    constexpr std::string_view unix_prefix = "unix:";
+    if (value.starts_with(unix_prefix)) {
+        ListenEndpoint endpoint;
+        endpoint.unix_path = value.substr(unix_prefix.size());
+
+        // Права отделяются последним двоеточием: 3-4 восьмеричные цифры
+        auto colon = endpoint.unix_path.rfind(':');
+        if (colon != std::string::npos) {
+            auto mode = std::string_view(endpoint.unix_path).substr(colon + 1);
+            if (mode.size() >= 3 && mode.size() <= 4
+                && std::all_of(mode.begin(), mode.end(), [](char c) { return c >= '0' && c <= '7'; })) {
+                endpoint.unix_mode = static_cast<unsigned>(std::stoul(std::string(mode), nullptr, 8));
+                if (*endpoint.unix_mode > 0777) {
+                    std::cerr << "Error: Invalid Unix socket mode in: " << value << "\n";
+                    exit(EXIT_FAILURE);
+                }
+                endpoint.unix_path.resize(colon);
+            }
+        }
+
+        if (endpoint.unix_path.empty()) {
+            std::cerr << "Error: Empty Unix socket path in: " << value << "\n";
+            exit(EXIT_FAILURE);
+        }
+        return endpoint;
+    }
+
+    // host:port, адрес IPv6 записывается в квадратных скобках: [::1]:8080
+    auto colon = value.rfind(':');
+    if (colon == std::string::npos || colon == 0) {
+        std::cerr << "Error: Invalid listen address: " << value << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    ListenEndpoint endpoint;
+    endpoint.host = value.substr(0, colon);
+    if (endpoint.host.size() > 2 && endpoint.host.front() == '[' && endpoint.host.back() == ']') {
+        endpoint.host = endpoint.host.substr(1, endpoint.host.size() - 2);
+    }
+
+    try {
+        int port = std::stoi(value.substr(colon + 1));
+        if (port <= 0 || port > 65535) {
+            throw std::out_of_range("port");
+        }
+        endpoint.port = static_cast<unsigned short>(port);
+    }
+    catch (const std::exception&) {
+        std::cerr << "Error: Invalid port in listen address: " << value << "\n";
+        exit(EXIT_FAILURE);
+    }
+    return endpoint;
+}
 
 struct Args {
     std::string config_file;
@@ -12,6 +82,15 @@ struct Args {
     int tick_period = 0;
     bool randomize_spawn_points = false;
     int save_state_period = 0;
+    std::string handoff_socket;
+    std::string takeover_socket;
+    int idle_timeout = 30;
+    size_t max_connections = 0;
+    std::vector<ListenEndpoint> listen;
+    // Память для массивов сущностей: heap, huge-pages или hugetlb
+    // По умолчанию куча: выигрыш от huge pages ещё не измерен на реальной нагрузке
+    std::string entity_memory = "heap";
+    bool early_hints = false;
 };
 
 Args ParseCommandLine(int argc, const char* const argv[]) {
@@ -35,7 +114,15 @@ Args ParseCommandLine(int argc, const char* const argv[]) {
                 << "  -t [ --tick-period ]   set tick period (milliseconds)\n"
                 << "  -c [ --config-file ]   set config file path (required)\n"
                 << "  -w [ --www-root ]      set static files root\n"
-                << "  --randomize-spawn-points spawn dogs at random positions\n";
+                << "  --randomize-spawn-points spawn dogs at random positions\n"
+                << "  --handoff-socket       accept a successor process on this Unix socket\n"
+                << "  --takeover             take over sockets and state from a running server\n"
+                << "  --idle-timeout         close idle connections after this many seconds (default 30)\n"
+                << "  --max-connections      limit concurrent connections, evicting the most idle ones\n"
+                << "  --listen               host:port, unix:path or unix:path:mode (octal, e.g. 0660)\n"
+                << "                         to accept connections on, may be repeated (default 0.0.0.0:8080)\n"
+                << "  --entity-memory        heap (default), huge-pages or hugetlb\n"
+                << "  --early-hints          send 103 Early Hints with preload links for pages\n";
             exit(EXIT_SUCCESS);
         }
         else if (arg == "--tick-period" || arg == "-t") {
@@ -57,6 +144,46 @@ Args ParseCommandLine(int argc, const char* const argv[]) {
         else if (arg == "--state-file" || arg == "-s") {
             args.state_file = get_next_arg(i);
         }
+        else if (arg == "--handoff-socket") {
+            args.handoff_socket = get_next_arg(i);
+        }
+        else if (arg == "--takeover") {
+            args.takeover_socket = get_next_arg(i);
+        }
+        else if (arg == "--idle-timeout") {
+            std::string value = get_next_arg(i);
+            try {
+                args.idle_timeout = std::stoi(value);
+            }
+            catch (const std::exception&) {
+                std::cerr << "Error: Invalid idle timeout value: " << value << "\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (arg == "--max-connections") {
+            std::string value = get_next_arg(i);
+            try {
+                args.max_connections = std::stoul(value);
+            }
+            catch (const std::exception&) {
+                std::cerr << "Error: Invalid max connections value: " << value << "\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (arg == "--listen") {
+            args.listen.push_back(ParseListenEndpoint(get_next_arg(i)));
+        }
+        else if (arg == "--entity-memory") {
+            args.entity_memory = get_next_arg(i);
+            if (args.entity_memory != "heap" && args.entity_memory != "huge-pages"
+                && args.entity_memory != "hugetlb") {
+                std::cerr << "Error: Invalid entity memory: " << args.entity_memory << "\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (arg == "--early-hints") {
+            args.early_hints = true;
+        }
         else if (arg == "--randomize-spawn-points") {
             args.randomize_spawn_points = true;
         }
@@ -86,5 +213,9 @@ Args ParseCommandLine(int argc, const char* const argv[]) {
         exit(1);
     }
 
+    if (args.listen.empty()) {
+        args.listen.push_back({ "0.0.0.0", 8080, {}, std::nullopt });
+    }
+
     return args;
 }
\ No newline at end of file
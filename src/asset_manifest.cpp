@@ -0,0 +1,204 @@
+#include "asset_manifest.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <unordered_set>
+#include <vector>
+
+namespace assets {
+
+    namespace fs = std::filesystem;
+    using namespace std::literals;
+
+    namespace {
+        constexpr std::string_view MAPS_API = "/api/v1/maps/"sv;
+        constexpr size_t MAX_ASSET_PATH = 256;
+
+        struct Preload {
+            std::string url;
+            std::string_view as;
+        };
+
+        std::string ReadFile(const fs::path& path) {
+            std::ifstream file(path, std::ios::binary);
+            return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+        }
+
+        // В заголовок попадают только пути без символов, требующих экранирования
+        bool IsSafeUrl(std::string_view url) {
+            return !url.empty() && std::all_of(url.begin(), url.end(), [](unsigned char c) {
+                return std::isalnum(c) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~';
+                });
+        }
+
+        // Превращает ссылку со страницы в путь от корня сайта. Пустая строка для внешних
+        // ссылок, выходов за пределы www-root и несуществующих файлов
+        std::string ResolveLocalUrl(const fs::path& www_root, const fs::path& page_dir, std::string_view ref) {
+            if (ref.empty() || ref.find("://"sv) != std::string_view::npos || ref.starts_with("//"sv)) {
+                return {};
+            }
+            ref = ref.substr(0, ref.find_first_of("?#"sv));
+
+            fs::path relative = ref.starts_with('/') ? fs::path(ref.substr(1)) : page_dir / fs::path(ref);
+            relative = relative.lexically_normal();
+            if (relative.empty() || *relative.begin() == "..") {
+                return {};
+            }
+
+            std::error_code ec;
+            if (!fs::is_regular_file(www_root / relative, ec)) {
+                return {};
+            }
+
+            auto url = "/" + relative.generic_string();
+            return IsSafeUrl(url) ? url : std::string{};
+        }
+
+        bool IsModelOrTexture(std::string_view path) {
+            constexpr std::array extensions{
+                ".fbx"sv, ".obj"sv, ".mtl"sv, ".gltf"sv, ".glb"sv, ".bin"sv, ".png"sv, ".jpg"sv, ".jpeg"sv
+            };
+            return std::any_of(extensions.begin(), extensions.end(), [path](std::string_view ext) {
+                return path.size() > ext.size() && path.ends_with(ext);
+                });
+        }
+
+        // Ищет в скрипте строковые литералы с путями к моделям и текстурам.
+        // Скрипты бывают большими (three.js), поэтому обходимся без регулярных выражений
+        void CollectScriptAssets(const fs::path& www_root, const std::string& script,
+            std::vector<Preload>& preloads) {
+            for (size_t pos = script.find_first_of("\"'"); pos != std::string::npos;) {
+                const char quote = script[pos];
+                const size_t end = script.find(quote, pos + 1);
+                if (end == std::string::npos) {
+                    break;
+                }
+                std::string_view literal(script.data() + pos + 1, end - pos - 1);
+                if (literal.size() <= MAX_ASSET_PATH && IsModelOrTexture(literal)) {
+                    // Загрузчики three.js разрешают пути относительно страницы в корне сайта
+                    if (auto url = ResolveLocalUrl(www_root, {}, literal); !url.empty()) {
+                        preloads.push_back({ std::move(url), "fetch"sv });
+                    }
+                }
+                pos = script.find_first_of("\"'", end + 1);
+            }
+        }
+
+        std::string FormatLinks(const std::vector<Preload>& preloads) {
+            std::string links;
+            std::unordered_set<std::string_view> seen;
+            for (const auto& preload : preloads) {
+                if (!seen.insert(preload.url).second) {
+                    continue;
+                }
+                if (!links.empty()) {
+                    links += ", "sv;
+                }
+                links += '<';
+                links += preload.url;
+                links += ">; rel=preload; as="sv;
+                links += preload.as;
+                // fetch() и XHR делают CORS-запросы, без crossorigin браузер не использует предзагрузку
+                if (preload.as == "fetch"sv) {
+                    links += "; crossorigin"sv;
+                }
+            }
+            return links;
+        }
+    }  // namespace
+
+    AssetManifest AssetManifest::Build(const fs::path& www_root, const model::Game& game) {
+        AssetManifest manifest;
+
+        static const std::regex script_re(R"(<script\b[^>]*\bsrc\s*=\s*["']([^"']+)["'])", std::regex::icase);
+        static const std::regex link_re(R"(<link\b[^>]*>)", std::regex::icase);
+        static const std::regex stylesheet_re(R"(\brel\s*=\s*["']?stylesheet\b)", std::regex::icase);
+        static const std::regex href_re(R"(\bhref\s*=\s*["']([^"']+)["'])", std::regex::icase);
+
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(www_root, ec), end; !ec && it != end; it.increment(ec)) {
+            const auto& path = it->path();
+            if (!it->is_regular_file(ec) || path.extension() != ".html") {
+                continue;
+            }
+
+            const auto html = ReadFile(path);
+            const auto page = path.lexically_relative(www_root);
+            const auto page_dir = page.parent_path();
+
+            std::vector<Preload> preloads;
+            std::vector<Preload> script_assets;
+
+            for (std::sregex_iterator match(html.begin(), html.end(), script_re), last; match != last; ++match) {
+                if (auto url = ResolveLocalUrl(www_root, page_dir, (*match)[1].str()); !url.empty()) {
+                    CollectScriptAssets(www_root, ReadFile(www_root / url.substr(1)), script_assets);
+                    preloads.push_back({ std::move(url), "script"sv });
+                }
+            }
+
+            for (std::sregex_iterator match(html.begin(), html.end(), link_re), last; match != last; ++match) {
+                const auto tag = match->str();
+                std::smatch href;
+                if (std::regex_search(tag, stylesheet_re) && std::regex_search(tag, href, href_re)) {
+                    if (auto url = ResolveLocalUrl(www_root, page_dir, href[1].str()); !url.empty()) {
+                        preloads.push_back({ std::move(url), "style"sv });
+                    }
+                }
+            }
+
+            // Модели нужны позже скриптов, поэтому идут в конце списка
+            preloads.insert(preloads.end(), script_assets.begin(), script_assets.end());
+
+            Page entry{ FormatLinks(preloads), html.find(MAPS_API) != std::string::npos };
+            if (!entry.links.empty() || entry.loads_map) {
+                manifest.pages_.emplace(page.generic_string(), std::move(entry));
+            }
+        }
+
+        for (const auto& map : game.GetMaps()) {
+            const auto& map_id = *map.GetId();
+            std::vector<Preload> preloads;
+
+            if (auto url = std::string(MAPS_API) + map_id; IsSafeUrl(url)) {
+                preloads.push_back({ std::move(url), "fetch"sv });
+            }
+            for (const auto& loot_type : map.GetLootTypes()) {
+                const auto* file = loot_type.is_object() ? loot_type.as_object().if_contains("file") : nullptr;
+                if (file && file->is_string()) {
+                    if (auto url = ResolveLocalUrl(www_root, {}, std::string(file->as_string())); !url.empty()) {
+                        preloads.push_back({ std::move(url), "fetch"sv });
+                    }
+                }
+            }
+
+            if (auto links = FormatLinks(preloads); !links.empty()) {
+                manifest.maps_.emplace(map_id, std::move(links));
+            }
+        }
+
+        return manifest;
+    }
+
+    std::string AssetManifest::GetLinkHeader(std::string_view page, std::string_view map_id) const {
+        auto page_it = pages_.find(std::string(page));
+        if (page_it == pages_.end()) {
+            return {};
+        }
+
+        std::string links = page_it->second.links;
+        if (page_it->second.loads_map && !map_id.empty()) {
+            if (auto map_it = maps_.find(std::string(map_id)); map_it != maps_.end()) {
+                if (!links.empty()) {
+                    links += ", "sv;
+                }
+                links += map_it->second;
+            }
+        }
+        return links;
+    }
+
+}  // namespace assets
@@ -0,0 +1,40 @@
+#pragma once
+#include "model.h"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace assets {
+
+    // Манифест ресурсов, которые нужны страницам из www-root и картам.
+    // Строится при старте: из HTML берутся скрипты и стили, из подключённых скриптов -
+    // упомянутые в них модели и текстуры, из конфигурации карт - описание карты и модели лута.
+    // По манифесту сервер отдаёт заголовок Link: rel=preload (и 103 Early Hints),
+    // чтобы браузер загружал ресурсы параллельно, а не цепочкой
+    class AssetManifest {
+    public:
+        static AssetManifest Build(const std::filesystem::path& www_root, const model::Game& game);
+
+        // Значение заголовка Link для страницы (путь относительно www-root).
+        // Для страниц, загружающих карту, добавляются ресурсы карты map_id.
+        // Пустая строка, если подсказывать нечего
+        std::string GetLinkHeader(std::string_view page, std::string_view map_id) const;
+
+        size_t GetPageCount() const noexcept {
+            return pages_.size();
+        }
+
+    private:
+        struct Page {
+            std::string links;
+            // Страница запрашивает /api/v1/maps/{id}
+            bool loads_map = false;
+        };
+
+        std::unordered_map<std::string, Page> pages_;
+        std::unordered_map<std::string, std::string> maps_;
+    };
+
+}  // namespace assets
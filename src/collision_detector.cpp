@@ -1,5 +1,7 @@
 #include "collision_detector.h"
 #include <cassert>
+#include <cmath>
+#include <iterator>
 
 namespace collision_detector {
 
@@ -61,4 +63,107 @@ namespace collision_detector {
         return events;
     }
 
+    StaticItemIndex::StaticItemIndex(std::vector<Item> items, const std::vector<Line>& lines,
+        double max_gatherer_width, double line_half_width)
+        : items_(std::move(items))
+        , max_gatherer_width_(max_gatherer_width)
+        , line_half_width_(line_half_width) {
+        // Предмет относится к линии, если его может задеть собиратель, идущий вдоль неё
+        const double reach = line_half_width_ + max_gatherer_width_;
+
+        for (const auto& line : lines) {
+            auto& line_triggers = line.horizontal ? horizontal_[line.axis] : vertical_[line.axis];
+            if (!line_triggers.empty()) {
+                // Коллинеарные дороги делят одну линию
+                continue;
+            }
+
+            for (size_t item_idx = 0; item_idx < items_.size(); ++item_idx) {
+                const auto& pos = items_[item_idx].position;
+                const double along = line.horizontal ? pos.x : pos.y;
+                const double lateral = line.horizontal ? pos.y : pos.x;
+                if (std::abs(lateral - line.axis) <= reach) {
+                    line_triggers.push_back({ along, lateral, item_idx });
+                }
+            }
+
+            std::sort(line_triggers.begin(), line_triggers.end(), [](const Trigger& lhs, const Trigger& rhs) {
+                return lhs.along < rhs.along;
+                });
+        }
+    }
+
+    void StaticItemIndex::FindEvents(size_t gatherer_id, const Gatherer& gatherer,
+        std::vector<GatheringEvent>& events) const {
+        const auto& start = gatherer.start_pos;
+        const auto& end = gatherer.end_pos;
+
+        // Пропускаем собирателей с нулевым перемещением
+        if (start.x == end.x && start.y == end.y) {
+            return;
+        }
+
+        if (gatherer.width <= max_gatherer_width_) {
+            if (start.y == end.y
+                && FindLineEvents(horizontal_, gatherer_id, start.y, start.x, end.x, gatherer.width, events)) {
+                return;
+            }
+            if (start.x == end.x
+                && FindLineEvents(vertical_, gatherer_id, start.x, start.y, end.y, gatherer.width, events)) {
+                return;
+            }
+        }
+
+        // Движение не вдоль единственной линии дороги - проверяем все предметы
+        FindEventsBruteForce(gatherer_id, gatherer, events);
+    }
+
+    bool StaticItemIndex::FindLineEvents(const Lines& lines, size_t gatherer_id, double lateral,
+        double along_start, double along_end, double width,
+        std::vector<GatheringEvent>& events) const {
+        // Ищем линию, в полосе которой находится собиратель
+        auto line_it = lines.lower_bound(lateral - line_half_width_);
+        if (line_it == lines.end() || line_it->first > lateral + line_half_width_) {
+            return false;
+        }
+        if (auto next = std::next(line_it); next != lines.end() && next->first <= lateral + line_half_width_) {
+            // Полосы соседних линий пересекаются, однозначно выбрать линию нельзя
+            return false;
+        }
+
+        const auto& triggers = line_it->second;
+        const double along_min = std::min(along_start, along_end);
+        const double along_max = std::max(along_start, along_end);
+
+        auto first = std::lower_bound(triggers.begin(), triggers.end(), along_min,
+            [](const Trigger& trigger, double value) {
+                return trigger.along < value;
+            });
+
+        for (auto it = first; it != triggers.end() && it->along <= along_max; ++it) {
+            const double offset = it->lateral - lateral;
+            const double sq_distance = offset * offset;
+            if (sq_distance <= width * width) {
+                events.push_back({
+                    it->item_id,
+                    gatherer_id,
+                    sq_distance,
+                    (it->along - along_start) / (along_end - along_start)
+                    });
+            }
+        }
+
+        return true;
+    }
+
+    void StaticItemIndex::FindEventsBruteForce(size_t gatherer_id, const Gatherer& gatherer,
+        std::vector<GatheringEvent>& events) const {
+        for (size_t item_idx = 0; item_idx < items_.size(); ++item_idx) {
+            auto result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, items_[item_idx].position);
+            if (result.IsCollected(gatherer.width)) {
+                events.push_back({ item_idx, gatherer_id, result.sq_distance, result.proj_ratio });
+            }
+        }
+    }
+
 }  // namespace collision_detector
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <map>
 #include <vector>
 #include <cstddef>
 
@@ -53,4 +54,51 @@ namespace collision_detector {
 
     std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
 
+    // Неподвижные предметы (например, офисы), заранее разложенные по линиям дорог.
+    // Собака всегда движется вдоль оси, поэтому для неё достаточно найти линию,
+    // по которой она идёт, и двоичным поиском выбрать предметы на пройденном отрезке.
+    // Результат совпадает с FindGatherEvents для тех же предметов
+    class StaticItemIndex {
+    public:
+        struct Line {
+            bool horizontal;
+            // y для горизонтальной линии, x для вертикальной
+            double axis;
+        };
+
+        StaticItemIndex() = default;
+
+        // max_gatherer_width - наибольшая ширина собирателя, для которой строится индекс,
+        // line_half_width - насколько собиратель может отклониться от оси линии
+        StaticItemIndex(std::vector<Item> items, const std::vector<Line>& lines,
+            double max_gatherer_width, double line_half_width);
+
+        // Добавляет в events события сбора предметов собирателем gatherer_id
+        void FindEvents(size_t gatherer_id, const Gatherer& gatherer,
+            std::vector<GatheringEvent>& events) const;
+
+    private:
+        struct Trigger {
+            // Координата предмета вдоль линии и поперёк неё
+            double along;
+            double lateral;
+            size_t item_id;
+        };
+
+        using LineTriggers = std::vector<Trigger>;
+        using Lines = std::map<double, LineTriggers>;
+
+        bool FindLineEvents(const Lines& lines, size_t gatherer_id, double lateral,
+            double along_start, double along_end, double width,
+            std::vector<GatheringEvent>& events) const;
+        void FindEventsBruteForce(size_t gatherer_id, const Gatherer& gatherer,
+            std::vector<GatheringEvent>& events) const;
+
+        std::vector<Item> items_;
+        Lines horizontal_;
+        Lines vertical_;
+        double max_gatherer_width_ = 0.0;
+        double line_half_width_ = 0.0;
+    };
+
 }  // namespace collision_detector
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "connection_tracker.h"
+
+#include <boost/asio/strand.hpp>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+namespace http_server {
+
+    struct ConnectionTracker::Shard {
+        explicit Shard(net::io_context& ioc)
+            : timer(net::make_strand(ioc)) {
+        }
+
+        std::mutex mutex;
+        // Соединение лежит в слоте своего дедлайна (по модулю SLOT_COUNT).
+        // Дедлайн пересчитывается только когда колесо доходит до слота
+        std::vector<std::vector<std::weak_ptr<Entry>>> slots{ SLOT_COUNT };
+        uint64_t processed_tick = 0;
+        net::steady_timer timer;
+    };
+
+    ConnectionTracker::Entry::Entry(std::shared_ptr<ConnectionTracker> tracker,
+        std::weak_ptr<TrackedConnection> connection, size_t shard)
+        : tracker_(std::move(tracker))
+        , connection_(std::move(connection))
+        , shard_(shard)
+        , last_activity_(tracker_->NowTick()) {
+        tracker_->connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ConnectionTracker::Entry::~Entry() {
+        if (tracker_->connections_.fetch_sub(1, std::memory_order_relaxed) == 1) {
+            tracker_->NotifyIfDrained();
+        }
+    }
+
+    void ConnectionTracker::Entry::Touch() noexcept {
+        last_activity_.store(tracker_->NowTick(), std::memory_order_relaxed);
+    }
+
+    void ConnectionTracker::Entry::SetPhase(Phase phase) noexcept {
+        phase_.store(phase, std::memory_order_release);
+    }
+
+    bool ConnectionTracker::Entry::ConfirmClose() {
+        if (GetPhase() != Phase::HANDLING) {
+            return true;
+        }
+        closing_.store(false, std::memory_order_relaxed);
+        tracker_->Track(shared_from_this());
+        return false;
+    }
+
+    ConnectionTracker::ConnectionTracker(net::io_context& ioc, Config config)
+        : config_(config)
+        , timeout_ticks_(std::max<uint64_t>(1,
+            (std::chrono::duration_cast<Clock::duration>(config.idle_timeout) + GRANULARITY - Clock::duration{ 1 })
+            / GRANULARITY))
+        , start_(Clock::now()) {
+        shards_.reserve(std::max<size_t>(1, config_.shards));
+        for (size_t i = 0; i < std::max<size_t>(1, config_.shards); ++i) {
+            shards_.push_back(std::make_unique<Shard>(ioc));
+        }
+    }
+
+    ConnectionTracker::~ConnectionTracker() = default;
+
+    void ConnectionTracker::Run() {
+        for (auto& shard : shards_) {
+            ScheduleTick(*shard, NowTick() + 1);
+        }
+    }
+
+    bool ConnectionTracker::Admit() {
+        if (config_.max_connections == 0 || GetConnectionCount() < config_.max_connections) {
+            return true;
+        }
+        return EvictOldestIdle();
+    }
+
+    std::shared_ptr<ConnectionTracker::Entry> ConnectionTracker::Register(std::weak_ptr<TrackedConnection> connection) {
+        const size_t shard = next_shard_.fetch_add(1, std::memory_order_relaxed) % shards_.size();
+        auto entry = std::make_shared<Entry>(shared_from_this(), std::move(connection), shard);
+        Track(entry);
+        return entry;
+    }
+
+    uint64_t ConnectionTracker::NowTick() const noexcept {
+        return static_cast<uint64_t>((Clock::now() - start_) / GRANULARITY);
+    }
+
+    void ConnectionTracker::Track(const std::shared_ptr<Entry>& entry) {
+        const uint64_t deadline = entry->last_activity_.load(std::memory_order_relaxed) + timeout_ticks_;
+        auto& shard = *shards_[entry->shard_];
+        std::lock_guard lock{ shard.mutex };
+        shard.slots[deadline % SLOT_COUNT].push_back(entry);
+    }
+
+    void ConnectionTracker::ScheduleTick(Shard& shard, uint64_t tick) {
+        shard.timer.expires_at(start_ + GRANULARITY * tick);
+        shard.timer.async_wait([self = shared_from_this(), &shard](const boost::system::error_code& ec) {
+            if (!ec) {
+                self->OnTick(shard);
+            }
+            });
+    }
+
+    void ConnectionTracker::OnTick(Shard& shard) {
+        const uint64_t now = NowTick();
+        std::vector<std::shared_ptr<Entry>> expired;
+        {
+            std::lock_guard lock{ shard.mutex };
+            // После долгой паузы достаточно одного оборота колеса
+            uint64_t tick = std::max(shard.processed_tick + 1, now >= SLOT_COUNT ? now - SLOT_COUNT + 1 : 0);
+            for (; tick <= now; ++tick) {
+                auto due = std::exchange(shard.slots[tick % SLOT_COUNT], {});
+                for (auto& weak_entry : due) {
+                    auto entry = weak_entry.lock();
+                    if (!entry || entry->closing_.load(std::memory_order_relaxed)) {
+                        continue;
+                    }
+                    // Зависшая запись ответа ограничена тем же таймаутом, что и простой
+                    const uint64_t deadline = entry->GetPhase() == Phase::HANDLING
+                        ? now + timeout_ticks_
+                        : entry->last_activity_.load(std::memory_order_relaxed) + timeout_ticks_;
+                    if (deadline <= now) {
+                        entry->closing_.store(true, std::memory_order_relaxed);
+                        expired.push_back(std::move(entry));
+                    }
+                    else {
+                        shard.slots[deadline % SLOT_COUNT].push_back(std::move(weak_entry));
+                    }
+                }
+            }
+            shard.processed_tick = now;
+        }
+
+        for (auto& entry : expired) {
+            if (auto connection = entry->connection_.lock()) {
+                connection->CloseIdle();
+            }
+        }
+
+        ScheduleTick(shard, now + 1);
+    }
+
+    bool ConnectionTracker::EvictOldestIdle() {
+        std::shared_ptr<Entry> victim;
+        uint64_t victim_activity = std::numeric_limits<uint64_t>::max();
+
+        for (auto& shard : shards_) {
+            std::lock_guard lock{ shard->mutex };
+            // Слоты идут в порядке дедлайнов, поэтому первое найденное простаивающее
+            // соединение шарда - приблизительно самое давнее
+            for (size_t i = 1; i <= SLOT_COUNT; ++i) {
+                const auto& slot = shard->slots[(shard->processed_tick + i) % SLOT_COUNT];
+                bool found = false;
+                for (const auto& weak_entry : slot) {
+                    auto entry = weak_entry.lock();
+                    if (!entry || entry->GetPhase() != Phase::IDLE
+                        || entry->closing_.load(std::memory_order_relaxed)) {
+                        continue;
+                    }
+                    found = true;
+                    const uint64_t activity = entry->last_activity_.load(std::memory_order_relaxed);
+                    if (activity < victim_activity) {
+                        victim_activity = activity;
+                        victim = std::move(entry);
+                    }
+                }
+                if (found) {
+                    break;
+                }
+            }
+        }
+
+        if (!victim || victim->closing_.exchange(true, std::memory_order_relaxed)) {
+            return false;
+        }
+        if (auto connection = victim->connection_.lock()) {
+            connection->CloseIdle();
+        }
+        return true;
+    }
+
+    void ConnectionTracker::Drain(std::function<void()> on_drained) {
+        {
+            std::lock_guard lock{ drain_mutex_ };
+            on_drained_ = std::move(on_drained);
+        }
+        draining_.store(true, std::memory_order_release);
+
+        std::vector<std::shared_ptr<Entry>> idle;
+        for (auto& shard : shards_) {
+            std::lock_guard lock{ shard->mutex };
+            for (const auto& slot : shard->slots) {
+                for (const auto& weak_entry : slot) {
+                    auto entry = weak_entry.lock();
+                    if (entry && entry->GetPhase() == Phase::IDLE
+                        && !entry->closing_.exchange(true, std::memory_order_relaxed)) {
+                        idle.push_back(std::move(entry));
+                    }
+                }
+            }
+        }
+
+        for (auto& entry : idle) {
+            if (auto connection = entry->connection_.lock()) {
+                connection->CloseIdle();
+            }
+        }
+        idle.clear();
+        NotifyIfDrained();
+    }
+
+    void ConnectionTracker::NotifyIfDrained() {
+        if (!IsDraining() || GetConnectionCount() != 0) {
+            return;
+        }
+        std::function<void()> on_drained;
+        {
+            std::lock_guard lock{ drain_mutex_ };
+            on_drained = std::exchange(on_drained_, nullptr);
+        }
+        if (on_drained) {
+            on_drained();
+        }
+    }
+
+}  // namespace http_server
@@ -0,0 +1,135 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace http_server {
+
+    namespace net = boost::asio;
+
+    // Соединение, которое трекер может закрыть по таймауту или вытеснить
+    class TrackedConnection {
+    public:
+        // Вызывается из потока трекера, реализация сама переходит в executor соединения
+        virtual void CloseIdle() = 0;
+
+    protected:
+        ~TrackedConnection() = default;
+    };
+
+    // Общее колесо таймеров с шагом в секунду для таймаутов простоя и чтения.
+    // Соединения не заводят собственных таймеров asio, а лишь обновляют отметку
+    // времени последней активности. Колесо разбито на шарды (по числу потоков io_context),
+    // у каждого шарда один таймер и своя блокировка
+    class ConnectionTracker : public std::enable_shared_from_this<ConnectionTracker> {
+        struct Shard;
+
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr Clock::duration GRANULARITY = std::chrono::seconds{ 1 };
+        static constexpr size_t SLOT_COUNT = 64;
+
+        struct Config {
+            std::chrono::seconds idle_timeout{ 30 };
+            // 0 - количество соединений не ограничено
+            size_t max_connections = 0;
+            size_t shards = 1;
+        };
+
+        // Чем занято соединение
+        enum class Phase {
+            // Ждёт запрос: закрывается по таймауту и может быть вытеснено
+            IDLE,
+            // Запрос обрабатывается (в том числе ждёт тика): не закрывается и не вытесняется
+            HANDLING,
+            // Пишет ответ: закрывается, если запись не закончилась за таймаут
+            WRITING
+        };
+
+        // Состояние отдельного соединения. Живёт, пока живо соединение
+        class Entry : public std::enable_shared_from_this<Entry> {
+        public:
+            Entry(std::shared_ptr<ConnectionTracker> tracker, std::weak_ptr<TrackedConnection> connection,
+                size_t shard);
+            ~Entry();
+
+            Entry(const Entry&) = delete;
+            Entry& operator=(const Entry&) = delete;
+
+            // Отмечает активность соединения
+            void Touch() noexcept;
+            // Таймаут фаз IDLE и WRITING отсчитывается от последнего Touch
+            void SetPhase(Phase phase) noexcept;
+            Phase GetPhase() const noexcept {
+                return phase_.load(std::memory_order_acquire);
+            }
+
+            // Вызывается соединением перед закрытием. Если соединение успело получить
+            // запрос, закрытие отменяется и соединение снова отслеживается
+            bool ConfirmClose();
+
+        private:
+            friend class ConnectionTracker;
+
+            std::shared_ptr<ConnectionTracker> tracker_;
+            std::weak_ptr<TrackedConnection> connection_;
+            size_t shard_;
+            std::atomic<uint64_t> last_activity_;
+            std::atomic<Phase> phase_{ Phase::IDLE };
+            std::atomic<bool> closing_{ false };
+        };
+
+        ConnectionTracker(net::io_context& ioc, Config config);
+        ~ConnectionTracker();
+
+        ConnectionTracker(const ConnectionTracker&) = delete;
+        ConnectionTracker& operator=(const ConnectionTracker&) = delete;
+
+        void Run();
+
+        // Решает, можно ли принять новое соединение. При достижении лимита
+        // вытесняет самое давно простаивающее соединение
+        bool Admit();
+
+        std::shared_ptr<Entry> Register(std::weak_ptr<TrackedConnection> connection);
+
+        size_t GetConnectionCount() const noexcept {
+            return connections_.load(std::memory_order_relaxed);
+        }
+
+        // Закрывает соединения, ждущие запроса. Остальные закрываются после текущего ответа.
+        // on_drained вызывается один раз, когда соединений не останется, в любом потоке
+        void Drain(std::function<void()> on_drained);
+        bool IsDraining() const noexcept {
+            return draining_.load(std::memory_order_acquire);
+        }
+
+    private:
+        uint64_t NowTick() const noexcept;
+        void Track(const std::shared_ptr<Entry>& entry);
+        void ScheduleTick(Shard& shard, uint64_t tick);
+        void OnTick(Shard& shard);
+        bool EvictOldestIdle();
+        void NotifyIfDrained();
+
+        Config config_;
+        uint64_t timeout_ticks_;
+        Clock::time_point start_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+        std::atomic<size_t> next_shard_{ 0 };
+        std::atomic<size_t> connections_{ 0 };
+        std::atomic<bool> draining_{ false };
+        std::mutex drain_mutex_;
+        std::function<void()> on_drained_;
+    };
+
+}  // namespace http_server
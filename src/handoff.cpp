@@ -0,0 +1,402 @@
+#include "handoff.h"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace handoff {
+
+    using namespace std::literals;
+
+#ifndef _WIN32
+
+    namespace {
+        constexpr std::string_view HANDOFF_MAGIC = "HOF1";
+        constexpr char ACK = 'A';
+        constexpr size_t MAX_SOCKETS = 16;
+        // Новому процессу может понадобиться время, чтобы разобрать большое состояние
+        constexpr auto IO_TIMEOUT = 60s;
+        constexpr int POLL_INTERVAL_MS = 500;
+
+        [[noreturn]] void ThrowErrno(std::string_view what) {
+            throw std::system_error(errno, std::generic_category(), std::string(what));
+        }
+
+        class UniqueFd {
+        public:
+            explicit UniqueFd(int fd = -1) noexcept
+                : fd_(fd) {
+            }
+
+            UniqueFd(const UniqueFd&) = delete;
+            UniqueFd& operator=(const UniqueFd&) = delete;
+
+            ~UniqueFd() {
+                if (fd_ >= 0) {
+                    ::close(fd_);
+                }
+            }
+
+            int Get() const noexcept {
+                return fd_;
+            }
+
+            int Release() noexcept {
+                return std::exchange(fd_, -1);
+            }
+
+        private:
+            int fd_;
+        };
+
+        sockaddr_un MakeAddress(const std::filesystem::path& path) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            const auto& native = path.native();
+            if (native.size() >= sizeof(addr.sun_path)) {
+                throw std::invalid_argument("Handoff socket path is too long: " + path.string());
+            }
+            std::memcpy(addr.sun_path, native.c_str(), native.size() + 1);
+            return addr;
+        }
+
+        void SetTimeout(int fd, std::chrono::seconds timeout) {
+            timeval tv{};
+            tv.tv_sec = static_cast<time_t>(timeout.count());
+            if (::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0
+                || ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) != 0) {
+                ThrowErrno("setsockopt"sv);
+            }
+        }
+
+        void WriteAll(int fd, const void* data, size_t size) {
+            const char* ptr = static_cast<const char*>(data);
+            while (size > 0) {
+                ssize_t written = ::send(fd, ptr, size, MSG_NOSIGNAL);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    ThrowErrno("send"sv);
+                }
+                ptr += written;
+                size -= static_cast<size_t>(written);
+            }
+        }
+
+        void ReadAll(int fd, void* data, size_t size) {
+            char* ptr = static_cast<char*>(data);
+            while (size > 0) {
+                ssize_t received = ::recv(fd, ptr, size, 0);
+                if (received < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    ThrowErrno("recv"sv);
+                }
+                if (received == 0) {
+                    throw std::runtime_error("Handoff peer closed the connection");
+                }
+                ptr += received;
+                size -= static_cast<size_t>(received);
+            }
+        }
+
+        void WriteUint64(int fd, uint64_t value) {
+            std::array<unsigned char, sizeof(uint64_t)> bytes;
+            for (size_t i = 0; i < bytes.size(); ++i) {
+                bytes[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xFF);
+            }
+            WriteAll(fd, bytes.data(), bytes.size());
+        }
+
+        uint64_t ReadUint64(int fd) {
+            std::array<unsigned char, sizeof(uint64_t)> bytes;
+            ReadAll(fd, bytes.data(), bytes.size());
+            uint64_t value = 0;
+            for (size_t i = 0; i < bytes.size(); ++i) {
+                value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+            }
+            return value;
+        }
+
+        // Заголовок: сигнатура и количество сокетов, сами сокеты - в SCM_RIGHTS
+        void SendSockets(int fd, const std::vector<int>& sockets) {
+            if (sockets.empty() || sockets.size() > MAX_SOCKETS) {
+                throw std::invalid_argument("Invalid number of sockets to hand off");
+            }
+
+            std::array<char, HANDOFF_MAGIC.size() + 1> header{};
+            std::memcpy(header.data(), HANDOFF_MAGIC.data(), HANDOFF_MAGIC.size());
+            header.back() = static_cast<char>(sockets.size());
+
+            iovec iov{ header.data(), header.size() };
+            alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int) * MAX_SOCKETS)> control{};
+
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control.data();
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * sockets.size());
+
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * sockets.size());
+            std::memcpy(CMSG_DATA(cmsg), sockets.data(), sizeof(int) * sockets.size());
+
+            while (::sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+                if (errno != EINTR) {
+                    ThrowErrno("sendmsg"sv);
+                }
+            }
+        }
+
+        std::vector<int> ReceiveSockets(int fd) {
+            std::array<char, HANDOFF_MAGIC.size() + 1> header{};
+            iovec iov{ header.data(), header.size() };
+            alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int) * MAX_SOCKETS)> control{};
+
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control.data();
+            msg.msg_controllen = control.size();
+
+            ssize_t received;
+            while ((received = ::recvmsg(fd, &msg, MSG_CMSG_CLOEXEC)) < 0) {
+                if (errno != EINTR) {
+                    ThrowErrno("recvmsg"sv);
+                }
+            }
+
+            std::vector<int> sockets;
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                    const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    sockets.resize(count);
+                    std::memcpy(sockets.data(), CMSG_DATA(cmsg), sizeof(int) * count);
+                }
+            }
+
+            // Дочитываем заголовок, если он пришёл не целиком
+            if (received == 0) {
+                throw std::runtime_error("Handoff peer closed the connection");
+            }
+            if (static_cast<size_t>(received) < header.size()) {
+                ReadAll(fd, header.data() + received, header.size() - received);
+            }
+
+            if (std::string_view(header.data(), HANDOFF_MAGIC.size()) != HANDOFF_MAGIC
+                || (msg.msg_flags & MSG_CTRUNC)
+                || sockets.size() != static_cast<size_t>(header.back())) {
+                for (int socket : sockets) {
+                    ::close(socket);
+                }
+                throw std::runtime_error("Invalid handoff header");
+            }
+
+            return sockets;
+        }
+
+        SocketKind GetSocketKind(int fd) {
+            sockaddr_storage addr{};
+            socklen_t len = sizeof(addr);
+            if (::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+                ThrowErrno("getsockname"sv);
+            }
+            switch (addr.ss_family) {
+            case AF_INET: return SocketKind::TCP_V4;
+            case AF_INET6: return SocketKind::TCP_V6;
+            case AF_UNIX: return SocketKind::UNIX;
+            default: throw std::runtime_error("Unsupported inherited socket family");
+            }
+        }
+    }  // namespace
+
+    Inheritance ReceiveFromPredecessor(const std::filesystem::path& socket_path) {
+        UniqueFd connection{ ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+        if (connection.Get() < 0) {
+            ThrowErrno("socket"sv);
+        }
+
+        auto addr = MakeAddress(socket_path);
+        if (::connect(connection.Get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ThrowErrno("connect to " + socket_path.string());
+        }
+        SetTimeout(connection.Get(), IO_TIMEOUT);
+
+        Inheritance inheritance;
+        for (int fd : ReceiveSockets(connection.Get())) {
+            inheritance.sockets.push_back({ fd, GetSocketKind(fd) });
+        }
+
+        const uint64_t state_size = ReadUint64(connection.Get());
+        inheritance.state.resize(state_size);
+        ReadAll(connection.Get(), inheritance.state.data(), inheritance.state.size());
+
+        inheritance.connection_fd = connection.Release();
+        return inheritance;
+    }
+
+    void AcknowledgeTakeover(Inheritance& inheritance) {
+        UniqueFd connection{ std::exchange(inheritance.connection_fd, -1) };
+        if (connection.Get() < 0) {
+            return;
+        }
+        WriteAll(connection.Get(), &ACK, sizeof(ACK));
+    }
+
+    HandoffServer::HandoffServer(std::filesystem::path socket_path, std::vector<int> listen_fds,
+        FreezeHandler freeze, FinishHandler finish)
+        : socket_path_(std::move(socket_path))
+        , listen_fds_(std::move(listen_fds))
+        , freeze_(std::move(freeze))
+        , finish_(std::move(finish)) {
+    }
+
+    HandoffServer::~HandoffServer() {
+        if (thread_.joinable()) {
+            thread_.request_stop();
+            thread_.join();
+        }
+        if (listen_fd_ >= 0) {
+            ::close(listen_fd_);
+            // После передачи путь уже принадлежит новому процессу
+            if (!handed_off_) {
+                std::error_code ec;
+                std::filesystem::remove(socket_path_, ec);
+            }
+        }
+    }
+
+    void HandoffServer::Start() {
+        UniqueFd listen_fd{ ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+        if (listen_fd.Get() < 0) {
+            ThrowErrno("socket"sv);
+        }
+
+        // Путь может остаться от предыдущего процесса, который мы только что сменили
+        auto addr = MakeAddress(socket_path_);
+        ::unlink(addr.sun_path);
+        if (::bind(listen_fd.Get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ThrowErrno("bind " + socket_path_.string());
+        }
+        // Через этот сокет уходят слушающие сокеты и токены всех игроков. Права выставляем
+        // до listen: пока сокет не слушает, подключиться к нему нельзя
+        if (::chmod(addr.sun_path, S_IRUSR | S_IWUSR) != 0) {
+            ThrowErrno("chmod " + socket_path_.string());
+        }
+        if (::listen(listen_fd.Get(), 1) != 0) {
+            ThrowErrno("listen"sv);
+        }
+
+        listen_fd_ = listen_fd.Release();
+        thread_ = std::jthread([this](std::stop_token stop) { Run(stop); });
+    }
+
+    void HandoffServer::Run(std::stop_token stop) {
+        while (!stop.stop_requested()) {
+            pollfd pfd{ listen_fd_, POLLIN, 0 };
+            int ready = ::poll(&pfd, 1, POLL_INTERVAL_MS);
+            if (ready <= 0) {
+                continue;
+            }
+
+            UniqueFd client{ ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC) };
+            if (client.Get() < 0) {
+                continue;
+            }
+
+            // Состояние отдаём только процессу того же пользователя
+            ucred peer{};
+            socklen_t peer_len = sizeof(peer);
+            if (::getsockopt(client.Get(), SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) != 0
+                || peer.uid != ::geteuid()) {
+                std::cerr << "Handoff request rejected: peer uid " << peer.uid
+                    << " does not match server uid " << ::geteuid() << std::endl;
+                continue;
+            }
+
+            if (Serve(client.Get())) {
+                return;
+            }
+        }
+    }
+
+    bool HandoffServer::Serve(int client_fd) {
+        std::cout << "Handing off to a new server process..." << std::endl;
+
+        std::string state;
+        try {
+            SetTimeout(client_fd, IO_TIMEOUT);
+            state = freeze_();
+
+            SendSockets(client_fd, listen_fds_);
+            WriteUint64(client_fd, state.size());
+            WriteAll(client_fd, state.data(), state.size());
+
+            char ack = 0;
+            ReadAll(client_fd, &ack, sizeof(ack));
+            if (ack != ACK) {
+                throw std::runtime_error("Unexpected handoff acknowledgement");
+            }
+        }
+        catch (const std::exception& ex) {
+            std::cerr << "Handoff failed, continuing to serve: " << ex.what() << std::endl;
+            finish_(false);
+            return false;
+        }
+
+        handed_off_ = true;
+        std::cout << "Handoff complete, new process is accepting connections" << std::endl;
+        finish_(true);
+        return true;
+    }
+
+#else
+
+    Inheritance ReceiveFromPredecessor(const std::filesystem::path&) {
+        throw std::runtime_error("Server handoff is not supported on this platform");
+    }
+
+    void AcknowledgeTakeover(Inheritance&) {
+    }
+
+    HandoffServer::HandoffServer(std::filesystem::path socket_path, std::vector<int> listen_fds,
+        FreezeHandler freeze, FinishHandler finish)
+        : socket_path_(std::move(socket_path))
+        , listen_fds_(std::move(listen_fds))
+        , freeze_(std::move(freeze))
+        , finish_(std::move(finish)) {
+    }
+
+    HandoffServer::~HandoffServer() = default;
+
+    void HandoffServer::Start() {
+        throw std::runtime_error("Server handoff is not supported on this platform");
+    }
+
+    void HandoffServer::Run(std::stop_token) {
+    }
+
+    bool HandoffServer::Serve(int) {
+        return false;
+    }
+
+#endif
+
+}  // namespace handoff
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Перезапуск без простоя: работающий процесс передаёт новому свои слушающие
+// сокеты (SCM_RIGHTS через Unix-сокет) и снимок состояния игры.
+// Новый процесс начинает принимать соединения раньше, чем старый завершится
+namespace handoff {
+
+    enum class SocketKind {
+        TCP_V4,
+        TCP_V6,
+        UNIX
+    };
+
+    struct InheritedSocket {
+        int fd;
+        SocketKind kind;
+    };
+
+    // То, что новый процесс получил от предыдущего
+    struct Inheritance {
+        std::vector<InheritedSocket> sockets;
+        std::string state;
+        int connection_fd = -1;
+    };
+
+    // Подключается к работающему серверу и забирает его слушающие сокеты и состояние
+    Inheritance ReceiveFromPredecessor(const std::filesystem::path& socket_path);
+
+    // Сообщает предыдущему процессу, что новый уже принимает соединения
+    void AcknowledgeTakeover(Inheritance& inheritance);
+
+    class HandoffServer {
+    public:
+        // Останавливает приём соединений и тики, возвращает снимок состояния
+        using FreezeHandler = std::function<std::string()>;
+        // handed_off == false означает, что передача не удалась и работу надо продолжить
+        using FinishHandler = std::function<void(bool handed_off)>;
+
+        HandoffServer(std::filesystem::path socket_path, std::vector<int> listen_fds,
+            FreezeHandler freeze, FinishHandler finish);
+        ~HandoffServer();
+
+        HandoffServer(const HandoffServer&) = delete;
+        HandoffServer& operator=(const HandoffServer&) = delete;
+
+        void Start();
+
+    private:
+        void Run(std::stop_token stop);
+        bool Serve(int client_fd);
+
+        std::filesystem::path socket_path_;
+        std::vector<int> listen_fds_;
+        FreezeHandler freeze_;
+        FinishHandler finish_;
+        int listen_fd_ = -1;
+        std::atomic<bool> handed_off_{ false };
+        std::jthread thread_;
+    };
+
+}  // namespace handoff
@@ -1,49 +1,145 @@
 #include "http_server.h"
 
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <iostream>
+#include <stdexcept>
+#include <system_error>
 
 namespace http_server {
 
     using namespace std::literals;
 
-    void SessionBase::Run() {
-        // Вызываем метод Read, используя executor объекта stream_.
-        // Таким образом вся работа со stream_ будет выполняться, используя его executor
-        net::dispatch(stream_.get_executor(),
+    void PrepareToBind(tcp::acceptor& acceptor, [[maybe_unused]] const tcp::endpoint& endpoint) {
+        // После закрытия TCP-соединения сокет некоторое время может считаться занятым,
+        // чтобы компьютеры могли обменяться завершающими пакетами данных.
+        // Однако это может помешать повторно открыть сокет в полузакрытом состоянии.
+        // Флаг reuse_address разрешает открыть сокет, когда он "наполовину закрыт"
+        acceptor.set_option(net::socket_base::reuse_address(true));
+    }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    void PrepareToBind(local_stream::acceptor& acceptor, const local_stream::endpoint& endpoint) {
+        // Файл Unix-сокета переживает процесс, поэтому удаляем оставшийся от прошлого запуска.
+        // Обычные файлы не трогаем: bind вернёт ошибку
+        std::error_code ec;
+        if (!std::filesystem::is_socket(endpoint.path(), ec)) {
+            return;
+        }
+
+        // Файл остался от прошлого запуска, только если подключиться к нему некому.
+        // Иначе удаление молча отняло бы адрес у работающего сервера
+        local_stream::socket probe(acceptor.get_executor());
+        beast::error_code connect_ec;
+        probe.connect(endpoint, connect_ec);
+        if (connect_ec == net::error::connection_refused) {
+            std::filesystem::remove(endpoint.path(), ec);
+            return;
+        }
+        if (!connect_ec) {
+            throw std::runtime_error("Unix socket " + endpoint.path() + " is in use by a running server");
+        }
+        throw boost::system::system_error(connect_ec, "Cannot check Unix socket " + endpoint.path());
+    }
+#endif
+
+    void SetPermissions(const tcp::endpoint&, std::filesystem::perms) {
+        throw std::invalid_argument("Permissions can only be set for Unix sockets");
+    }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    void SetPermissions(const local_stream::endpoint& endpoint, std::filesystem::perms permissions) {
+        std::filesystem::permissions(endpoint.path(), permissions);
+    }
+#endif
+
+    template <typename Protocol>
+    void SessionBase<Protocol>::Run() {
+        activity_ = tracker_->Register(GetSharedThis());
+        // Вызываем метод Read, используя executor объекта socket_.
+        // Таким образом вся работа с socket_ будет выполняться, используя его executor
+        net::dispatch(socket_.get_executor(),
             beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
     }
 
-    void SessionBase::Read() {
+    template <typename Protocol>
+    void SessionBase<Protocol>::Read() {
         using namespace std::literals;
         // Очищаем запрос от прежнего значения (метод Read может быть вызван несколько раз)
         request_ = {};
-        stream_.expires_after(30s);
-        // Считываем request_ из stream_, используя buffer_ для хранения считанных данных
-        http::async_read(stream_, buffer_, request_,
+        if (tracker_->IsDraining()) {
+            // Сервер завершается, новых запросов не ждём
+            return Close();
+        }
+        // Отдельный таймер не взводим: дедлайн чтения отсчитывается от этой отметки
+        activity_->Touch();
+        activity_->SetPhase(ConnectionTracker::Phase::IDLE);
+        // Считываем request_ из socket_, используя buffer_ для хранения считанных данных
+        http::async_read(socket_, buffer_, request_,
             // По окончании операции будет вызван метод OnRead
             beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
     }
 
-    void SessionBase::OnRead(beast::error_code ec, std::size_t bytes_read) {
+    template <typename Protocol>
+    void SessionBase<Protocol>::OnRead(beast::error_code ec, std::size_t bytes_read) {
         using namespace std::literals;
         if (ec == http::error::end_of_stream) {
             // Нормальная ситуация - клиент закрыл соединение
             return Close();
         }
+        if (ec == net::error::operation_aborted) {
+            // Соединение закрыто по таймауту или вытеснено
+            return Close();
+        }
         if (ec) {
             ReportError(ec, "read"sv);
             return Close();
         }
+        activity_->SetPhase(ConnectionTracker::Phase::HANDLING);
         HandleRequest(std::move(request_));
     }
 
-    void SessionBase::OnWrite(bool close, beast::error_code ec, std::size_t bytes_written) {
+    template <typename Protocol>
+    void SessionBase<Protocol>::EnqueueWrite(std::function<void()> write) {
+        pending_writes_.push_back(std::move(write));
+        if (pending_writes_.size() == 1) {
+            StartWrite();
+        }
+    }
+
+    template <typename Protocol>
+    void SessionBase<Protocol>::StartWrite() {
+        // Клиент, который не читает ответ, не должен держать соединение вечно
+        activity_->Touch();
+        activity_->SetPhase(ConnectionTracker::Phase::WRITING);
+        pending_writes_.front()();
+    }
+
+    template <typename Protocol>
+    void SessionBase<Protocol>::OnWrite(bool interim, bool close, beast::error_code ec, std::size_t bytes_written) {
+        pending_writes_.pop_front();
+
         if (ec) {
-            ReportError(ec, "write"sv);
+            // Оставшиеся записи держат сессию, отбрасываем их
+            pending_writes_.clear();
+            // Запись, прерванная таймаутом, - не ошибка сервера
+            if (ec != net::error::operation_aborted) {
+                ReportError(ec, "write"sv);
+            }
             return Close();
         }
 
+        if (interim) {
+            // После промежуточного ответа ждём окончательный, а не следующий запрос
+            if (!pending_writes_.empty()) {
+                StartWrite();
+            }
+            else {
+                activity_->SetPhase(ConnectionTracker::Phase::HANDLING);
+            }
+            return;
+        }
+
         if (close) {
             // Семантика ответа требует закрыть соединение
             return Close();
@@ -53,9 +149,27 @@ namespace http_server {
         Read();
     }
 
-    void SessionBase::Close() {
-        stream_.socket().shutdown(tcp::socket::shutdown_send);
+    template <typename Protocol>
+    void SessionBase<Protocol>::Close() {
+        beast::error_code ec;
+        socket_.shutdown(net::socket_base::shutdown_send, ec);
     }
 
-}  // namespace http_server
+    template <typename Protocol>
+    void SessionBase<Protocol>::CloseIdle() {
+        net::post(socket_.get_executor(), [self = GetSharedThis()] {
+            if (!self->activity_->ConfirmClose()) {
+                // Пока решение принималось, пришёл запрос
+                return;
+            }
+            beast::error_code ec;
+            self->socket_.close(ec);
+            });
+    }
+
+    template class SessionBase<tcp>;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    template class SessionBase<local_stream>;
+#endif
 
+}  // namespace http_server
@@ -4,17 +4,28 @@
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/dispatch.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
+#include "connection_tracker.h"
 #include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <optional>
 
 namespace http_server {
 
     namespace net = boost::asio;
     using tcp = net::ip::tcp;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    using local_stream = net::local::stream_protocol;
+#endif
     namespace beast = boost::beast;
     namespace http = beast::http;
     namespace json = boost::json;
@@ -41,8 +52,34 @@ namespace http_server {
         return result;
     }
 
-    class SessionBase {
+    inline std::string EndpointToString(const tcp::endpoint& endpoint) {
+        return endpoint.address().to_string();
+    }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    // Клиенты Unix-сокета обычно безымянные, поэтому адрес почти всегда пуст
+    inline std::string EndpointToString(const local_stream::endpoint& endpoint) {
+        return "unix:" + endpoint.path();
+    }
+#endif
+
+    // Подготовка acceptor к bind, своя для каждого протокола
+    void PrepareToBind(tcp::acceptor& acceptor, const tcp::endpoint& endpoint);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    void PrepareToBind(local_stream::acceptor& acceptor, const local_stream::endpoint& endpoint);
+#endif
+
+    // Права доступа к привязанному адресу. Бывают только у Unix-сокетов
+    void SetPermissions(const tcp::endpoint& endpoint, std::filesystem::perms permissions);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    void SetPermissions(const local_stream::endpoint& endpoint, std::filesystem::perms permissions);
+#endif
+
+    template <typename Protocol>
+    class SessionBase : public TrackedConnection {
     public:
+        using Socket = typename Protocol::socket;
+
         // Запрещаем копирование и присваивание объектов SessionBase и его наследников
         SessionBase(const SessionBase&) = delete;
         SessionBase& operator=(const SessionBase&) = delete;
@@ -52,17 +89,28 @@ namespace http_server {
         void Write(http::response<Body, Fields>&& response) {
             // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
             auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
+            // Сервер завершается: после окончательного ответа соединение закрываем
+            if (tracker_->IsDraining() && safe_response->result_int() / 100 != 1) {
+                safe_response->keep_alive(false);
+            }
 
+            // Промежуточный ответ (103 Early Hints) уходит перед окончательным,
+            // поэтому записи выстраиваются в очередь в executor сокета
             auto self = GetSharedThis();
-            http::async_write(stream_, *safe_response,
-                [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-                    self->OnWrite(safe_response->need_eof(), ec, bytes_written);
+            net::dispatch(socket_.get_executor(), [self, safe_response] {
+                self->EnqueueWrite([self, safe_response] {
+                    http::async_write(self->socket_, *safe_response,
+                        [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
+                            const bool interim = safe_response->result_int() / 100 == 1;
+                            self->OnWrite(interim, safe_response->need_eof(), ec, bytes_written);
+                        });
+                    });
                 });
         }
 
         std::string GetRemoteIP() const {
             try {
-                return stream_.socket().remote_endpoint().address().to_string();
+                return EndpointToString(socket_.remote_endpoint());
             }
             catch (...) {
                 return "unknown";
@@ -70,8 +118,9 @@ namespace http_server {
         }
 
     protected:
-        explicit SessionBase(tcp::socket&& socket)
-            : stream_(std::move(socket)) {
+        SessionBase(Socket&& socket, std::shared_ptr<ConnectionTracker> tracker)
+            : socket_(std::move(socket))
+            , tracker_(std::move(tracker)) {
         }
         using HttpRequest = http::request<http::string_body>;
 
@@ -79,8 +128,11 @@ namespace http_server {
     private:
         void Read();
         void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
-        void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
+        void EnqueueWrite(std::function<void()> write);
+        void StartWrite();
+        void OnWrite(bool interim, bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
         void Close();
+        void CloseIdle() override;
         virtual void HandleRequest(HttpRequest&& request) = 0;
         virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
 
@@ -100,95 +152,200 @@ namespace http_server {
             std::cerr << where << ": " << ec.message() << std::endl;
         }
 
-        // tcp_stream содержит внутри себя сокет и добавляет поддержку таймаутов
-        beast::tcp_stream stream_;
+        // Таймауты отслеживает общий ConnectionTracker, поэтому достаточно обычного сокета
+        Socket socket_;
         beast::flat_buffer buffer_;
         HttpRequest request_;
+        // Ожидающие записи, первая из них выполняется
+        std::deque<std::function<void()>> pending_writes_;
+        std::shared_ptr<ConnectionTracker> tracker_;
+        std::shared_ptr<ConnectionTracker::Entry> activity_;
     };
 
-    template <typename RequestHandler>
-    class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
+    template <typename RequestHandler, typename Protocol = tcp>
+    class Session : public SessionBase<Protocol>,
+        public std::enable_shared_from_this<Session<RequestHandler, Protocol>> {
     public:
+        using Socket = typename Protocol::socket;
+        using HttpRequest = typename SessionBase<Protocol>::HttpRequest;
+
         template <typename Handler>
-        Session(tcp::socket&& socket, Handler&& request_handler)
-            : SessionBase(std::move(socket))
+        Session(Socket&& socket, std::shared_ptr<ConnectionTracker> tracker, Handler&& request_handler)
+            : SessionBase<Protocol>(std::move(socket), std::move(tracker))
             , request_handler_(std::forward<Handler>(request_handler)) {
         }
     private:
-        std::shared_ptr<SessionBase> GetSharedThis() override;
+        std::shared_ptr<SessionBase<Protocol>> GetSharedThis() override;
         void HandleRequest(HttpRequest&& request) override;
 
         RequestHandler request_handler_;
     };
 
-    template <typename RequestHandler>
-    class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
+    // Общий интерфейс слушателей, не зависящий от протокола и обработчика
+    class ListenerBase {
+    public:
+        using NativeHandle = tcp::acceptor::native_handle_type;
+
+        virtual ~ListenerBase() = default;
+
+        // Прекращает приём соединений, но оставляет сокет открытым.
+        // Новые подключения копятся в очереди ядра
+        virtual std::future<void> StopAccepting() = 0;
+        virtual void ResumeAccepting() = 0;
+        virtual NativeHandle GetNativeHandle() = 0;
+    };
+
+    template <typename RequestHandler, typename Protocol = tcp>
+    class Listener : public ListenerBase,
+        public std::enable_shared_from_this<Listener<RequestHandler, Protocol>> {
     public:
+        using Endpoint = typename Protocol::endpoint;
+        using Acceptor = typename Protocol::acceptor;
+        using Socket = typename Protocol::socket;
+
+        // permissions задаются файлу Unix-сокета до listen, пока к нему нельзя подключиться
         template <typename Handler>
-        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+        Listener(net::io_context& ioc, const Endpoint& endpoint, std::shared_ptr<ConnectionTracker> tracker,
+            Handler&& request_handler, std::optional<std::filesystem::perms> permissions = std::nullopt)
             : ioc_(ioc)
             // Обработчики асинхронных операций acceptor_ будут вызываться в своём strand
             , acceptor_(net::make_strand(ioc))
+            , tracker_(std::move(tracker))
             , request_handler_(std::forward<Handler>(request_handler)) {
-            // Открываем acceptor, используя протокол (IPv4 или IPv6), указанный в endpoint
+            // Открываем acceptor, используя протокол (IPv4, IPv6 или Unix-сокет), указанный в endpoint
             acceptor_.open(endpoint.protocol());
-
-            // После закрытия TCP-соединения сокет некоторое время может считаться занятым,
-            // чтобы компьютеры могли обменяться завершающими пакетами данных.
-            // Однако это может помешать повторно открыть сокет в полузакрытом состоянии.
-            // Флаг reuse_address разрешает открыть сокет, когда он "наполовину закрыт"
-            acceptor_.set_option(net::socket_base::reuse_address(true));
-            // Привязываем acceptor к адресу и порту endpoint
+            PrepareToBind(acceptor_, endpoint);
+            // Привязываем acceptor к адресу endpoint
             acceptor_.bind(endpoint);
+            if (permissions) {
+                SetPermissions(endpoint, *permissions);
+            }
             // Переводим acceptor в состояние, в котором он способен принимать новые соединения
             // Благодаря этому новые подключения будут помещаться в очередь ожидающих соединений
             acceptor_.listen(net::socket_base::max_listen_connections);
         }
 
+        // Принимает уже слушающий сокет, например, полученный от предыдущего процесса сервера
+        template <typename Handler>
+        Listener(net::io_context& ioc, const Protocol& protocol, NativeHandle native_acceptor,
+            std::shared_ptr<ConnectionTracker> tracker, Handler&& request_handler)
+            : ioc_(ioc)
+            , acceptor_(net::make_strand(ioc), protocol, native_acceptor)
+            , tracker_(std::move(tracker))
+            , request_handler_(std::forward<Handler>(request_handler)) {
+        }
+
         void Run() {
             DoAccept();
         }
+
+        std::future<void> StopAccepting() override {
+            auto done = std::make_shared<std::promise<void>>();
+            auto result = done->get_future();
+            net::dispatch(acceptor_.get_executor(), [self = this->shared_from_this(), done] {
+                self->accepting_ = false;
+                self->acceptor_.cancel();
+                done->set_value();
+                });
+            return result;
+        }
+
+        void ResumeAccepting() override {
+            net::dispatch(acceptor_.get_executor(), [self = this->shared_from_this()] {
+                if (!self->accepting_) {
+                    self->accepting_ = true;
+                    self->DoAccept();
+                }
+                });
+        }
+
+        NativeHandle GetNativeHandle() override {
+            return acceptor_.native_handle();
+        }
     private:
         void DoAccept() {
             acceptor_.async_accept(
                 net::make_strand(ioc_),
                 beast::bind_front_handler(&Listener::OnAccept, this->shared_from_this()));
         }
-        void AsyncRunSession(tcp::socket&& socket);
+        void AsyncRunSession(Socket&& socket);
 
-        void OnAccept(beast::error_code ec, tcp::socket socket) {
+        void OnAccept(beast::error_code ec, Socket socket) {
+            if (!accepting_) {
+                // Приём остановлен, сокет передаётся другому процессу
+                return;
+            }
             if (ec) {
                 // Обработка ошибки
                 return;
             }
-            else {
+            else if (tracker_->Admit()) {
                 AsyncRunSession(std::move(socket));
             }
+            else {
+                // Лимит соединений исчерпан, и вытеснить некого: все соединения заняты запросами
+                beast::error_code ignored;
+                socket.close(ignored);
+            }
             DoAccept();
         }
 
 
         net::io_context& ioc_;
-        tcp::acceptor acceptor_;
+        Acceptor acceptor_;
+        std::shared_ptr<ConnectionTracker> tracker_;
         RequestHandler request_handler_;
+        bool accepting_ = true;
     };
 
     template <typename RequestHandler>
-    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+    auto ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, std::shared_ptr<ConnectionTracker> tracker,
+        RequestHandler&& handler) {
         // При помощи decay_t исключим ссылки из типа RequestHandler,
         // чтобы Listener хранил RequestHandler по значению
         using MyListener = Listener<std::decay_t<RequestHandler>>;
 
-        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+        auto listener = std::make_shared<MyListener>(ioc, endpoint, std::move(tracker),
+            std::forward<RequestHandler>(handler));
+        listener->Run();
+        return listener;
+    }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    // Обслуживает Unix-сокет. Локальный обратный прокси обходится без TCP loopback
+    template <typename RequestHandler>
+    auto ServeHttp(net::io_context& ioc, const local_stream::endpoint& endpoint,
+        std::optional<std::filesystem::perms> permissions, std::shared_ptr<ConnectionTracker> tracker,
+        RequestHandler&& handler) {
+        using MyListener = Listener<std::decay_t<RequestHandler>, local_stream>;
+
+        auto listener = std::make_shared<MyListener>(ioc, endpoint, std::move(tracker),
+            std::forward<RequestHandler>(handler), permissions);
+        listener->Run();
+        return listener;
+    }
+#endif
+
+    // Обслуживает уже открытый слушающий сокет
+    template <typename Protocol, typename RequestHandler>
+    auto ServeHttp(net::io_context& ioc, const Protocol& protocol,
+        ListenerBase::NativeHandle native_acceptor, std::shared_ptr<ConnectionTracker> tracker,
+        RequestHandler&& handler) {
+        using MyListener = Listener<std::decay_t<RequestHandler>, Protocol>;
+
+        auto listener = std::make_shared<MyListener>(ioc, protocol, native_acceptor, std::move(tracker),
+            std::forward<RequestHandler>(handler));
+        listener->Run();
+        return listener;
     }
 
-    template<typename RequestHandler>
-    inline std::shared_ptr<SessionBase> Session<RequestHandler>::GetSharedThis() {
+    template<typename RequestHandler, typename Protocol>
+    inline std::shared_ptr<SessionBase<Protocol>> Session<RequestHandler, Protocol>::GetSharedThis() {
         return this->shared_from_this();
     }
 
-    template<typename RequestHandler>
-    inline void Session<RequestHandler>::HandleRequest(HttpRequest&& request) {
+    template<typename RequestHandler, typename Protocol>
+    inline void Session<RequestHandler, Protocol>::HandleRequest(HttpRequest&& request) {
         // Захватываем умный указатель на текущий объект Session в лямбде,
         // чтобы продлить время жизни сессии до вызова лямбды.
         // Используется generic-лямбда функция, способная принять response произвольного типа
@@ -197,9 +354,9 @@ namespace http_server {
             });
     }
 
-    template<typename RequestHandler>
-    inline void Listener<RequestHandler>::AsyncRunSession(tcp::socket&& socket) {
-        std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
+    template<typename RequestHandler, typename Protocol>
+    inline void Listener<RequestHandler, Protocol>::AsyncRunSession(Socket&& socket) {
+        std::make_shared<Session<RequestHandler, Protocol>>(std::move(socket), tracker_, request_handler_)->Run();
     }
 
 }  // namespace http_server
\ No newline at end of file
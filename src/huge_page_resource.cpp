@@ -0,0 +1,136 @@
+#include "huge_page_resource.h"
+
+#include <atomic>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace memory {
+
+    namespace {
+        size_t RoundUp(size_t value, size_t alignment) noexcept {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        std::pmr::pool_options EntityPoolOptions() {
+            std::pmr::pool_options options;
+            // Всё, что меньше huge page, обслуживает пул, крупные массивы получают свои отображения
+            options.largest_required_pool_block = HugePageResource::HUGE_PAGE_SIZE;
+            return options;
+        }
+
+        std::atomic<std::pmr::memory_resource*> entity_resource{ std::pmr::new_delete_resource() };
+    }  // namespace
+
+    HugePageResource::HugePageResource(bool use_hugetlb, size_t region_size)
+        : use_hugetlb_(use_hugetlb)
+        , region_size_(RoundUp(region_size, HUGE_PAGE_SIZE)) {
+    }
+
+    HugePageResource::~HugePageResource() {
+        for (const auto& region : regions_) {
+            Unmap(region.base, region.size);
+        }
+    }
+
+    void* HugePageResource::do_allocate(size_t bytes, size_t alignment) {
+        if (bytes >= HUGE_PAGE_SIZE || alignment > HUGE_PAGE_SIZE) {
+            return Map(RoundUp(bytes, HUGE_PAGE_SIZE));
+        }
+
+        std::lock_guard lock{ mutex_ };
+        auto aligned = reinterpret_cast<std::byte*>(RoundUp(reinterpret_cast<size_t>(cursor_), alignment));
+        if (!cursor_ || aligned + bytes > end_) {
+            // Остаток текущего региона пропадает, пул запрашивает память крупными порциями
+            auto base = static_cast<std::byte*>(Map(region_size_));
+            regions_.push_back({ base, region_size_ });
+            cursor_ = base;
+            end_ = base + region_size_;
+            aligned = cursor_;
+        }
+        cursor_ = aligned + bytes;
+        return aligned;
+    }
+
+    void HugePageResource::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+        if (bytes >= HUGE_PAGE_SIZE || alignment > HUGE_PAGE_SIZE) {
+            Unmap(ptr, RoundUp(bytes, HUGE_PAGE_SIZE));
+        }
+        // Мелкие блоки живут до уничтожения ресурса
+    }
+
+#ifndef _WIN32
+    void* HugePageResource::Map(size_t size) {
+#ifdef MAP_HUGETLB
+        if (use_hugetlb_) {
+            void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (ptr != MAP_FAILED) {
+                return ptr;
+            }
+            // Страницы в hugetlbfs не зарезервированы: используем прозрачные huge pages
+        }
+#endif
+        // Запрашиваем с запасом, чтобы выровнять начало по границе huge page
+        const size_t reserved = size + HUGE_PAGE_SIZE;
+        void* raw = ::mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        auto begin = static_cast<std::byte*>(raw);
+        auto aligned = reinterpret_cast<std::byte*>(RoundUp(reinterpret_cast<size_t>(begin), HUGE_PAGE_SIZE));
+        if (aligned != begin) {
+            ::munmap(begin, aligned - begin);
+        }
+        if (auto tail = begin + reserved - (aligned + size); tail > 0) {
+            ::munmap(aligned + size, tail);
+        }
+
+#ifdef MADV_HUGEPAGE
+        ::madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        return aligned;
+    }
+
+    void HugePageResource::Unmap(void* ptr, size_t size) noexcept {
+        ::munmap(ptr, size);
+    }
+#else
+    // Под Windows huge pages требуют особых привилегий, используем обычную кучу
+    void* HugePageResource::Map(size_t size) {
+        return ::operator new(size, std::align_val_t{ HUGE_PAGE_SIZE });
+    }
+
+    void HugePageResource::Unmap(void* ptr, [[maybe_unused]] size_t size) noexcept {
+        ::operator delete(ptr, std::align_val_t{ HUGE_PAGE_SIZE });
+    }
+#endif
+
+    void ConfigureEntityMemory(EntityMemory mode) {
+        // Ресурсы живут до конца программы: на них могут ссылаться ещё не удалённые сессии
+        static HugePageResource transparent_pages{ false };
+        static HugePageResource hugetlb_pages{ true };
+        static std::pmr::synchronized_pool_resource transparent_pool{ EntityPoolOptions(), &transparent_pages };
+        static std::pmr::synchronized_pool_resource hugetlb_pool{ EntityPoolOptions(), &hugetlb_pages };
+
+        switch (mode) {
+        case EntityMemory::HEAP:
+            entity_resource = std::pmr::new_delete_resource();
+            break;
+        case EntityMemory::HUGE_PAGES:
+            entity_resource = &transparent_pool;
+            break;
+        case EntityMemory::HUGETLB:
+            entity_resource = &hugetlb_pool;
+            break;
+        }
+    }
+
+    std::pmr::memory_resource* GetEntityResource() noexcept {
+        return entity_resource.load(std::memory_order_relaxed);
+    }
+
+}  // namespace memory
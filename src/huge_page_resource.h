@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace memory {
+
+    // Ресурс памяти на больших регионах, подкреплённых huge pages.
+    // Регионы выравниваются по 2 МБ и помечаются madvise(MADV_HUGEPAGE), либо, если
+    // включено и в системе зарезервированы страницы, берутся из hugetlbfs (MAP_HUGETLB).
+    // Крупные блоки (от размера huge page) получают собственное отображение и
+    // возвращаются системе при освобождении. Мелкие нарезаются из общего региона и
+    // не освобождаются, поэтому ресурс предназначен для роли upstream у пулового ресурса
+    class HugePageResource : public std::pmr::memory_resource {
+    public:
+        static constexpr size_t HUGE_PAGE_SIZE = size_t{ 2 } * 1024 * 1024;
+        static constexpr size_t DEFAULT_REGION_SIZE = size_t{ 64 } * 1024 * 1024;
+
+        explicit HugePageResource(bool use_hugetlb = false, size_t region_size = DEFAULT_REGION_SIZE);
+        ~HugePageResource() override;
+
+        HugePageResource(const HugePageResource&) = delete;
+        HugePageResource& operator=(const HugePageResource&) = delete;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        void* Map(size_t size);
+        void Unmap(void* ptr, size_t size) noexcept;
+
+        struct Region {
+            std::byte* base;
+            size_t size;
+        };
+
+        const bool use_hugetlb_;
+        const size_t region_size_;
+        std::mutex mutex_;
+        std::vector<Region> regions_;
+        std::byte* cursor_ = nullptr;
+        std::byte* end_ = nullptr;
+    };
+
+    enum class EntityMemory {
+        // Обычная куча (или подменённый при сборке malloc)
+        HEAP,
+        // Прозрачные huge pages через madvise
+        HUGE_PAGES,
+        // Явные huge pages из hugetlbfs с откатом на прозрачные
+        HUGETLB
+    };
+
+    // Выбирает, откуда игровые сессии берут память под массивы игроков и лута.
+    // Действует на сессии, созданные после вызова
+    void ConfigureEntityMemory(EntityMemory mode);
+
+    std::pmr::memory_resource* GetEntityResource() noexcept;
+
+}  // namespace memory
@@ -1,5 +1,6 @@
 #include <boost/asio/signal_set.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <chrono>
 #include <iostream>
 #include <mutex>
@@ -7,7 +8,10 @@
 #include <vector>
 #include <memory>
 #include <cstdlib>
+#include <future>
+#include <optional>
 #include <string_view>
+#include <filesystem>
 
 #include "sdk.h"
 #include "json_loader.h"
@@ -17,14 +21,12 @@
 #include "args.h"
 #include "serializing_listener.h"
 #include "record_repository.h"
+#include "handoff.h"
 
 using namespace std::literals;
 namespace net = boost::asio;
 namespace sys = boost::system;
 
-const auto address = net::ip::make_address("0.0.0.0");
-constexpr net::ip::port_type port = 8080;
-
 namespace {
     template <typename Fn>
     void RunWorkers(unsigned n, const Fn& fn) {
@@ -36,6 +38,42 @@ namespace {
         }
         fn();
     }
+
+    // Держит API strand занятым, пока снимок состояния передаётся новому процессу.
+    // Запросы, накопившиеся в strand за это время, после успешной передачи
+    // должны быть отброшены до Release, иначе они изменят уже отправленное состояние
+    class ApiFreeze {
+    public:
+        template <typename Executor, typename Snapshot>
+        std::string Freeze(const Executor& executor, Snapshot&& snapshot) {
+            auto result = std::make_shared<std::promise<std::string>>();
+            auto release = std::make_shared<std::promise<void>>();
+            auto snapshot_ready = result->get_future();
+            release_ = release;
+
+            net::post(executor, [result, released = release->get_future(),
+                snapshot = std::forward<Snapshot>(snapshot)]() mutable {
+                try {
+                    result->set_value(snapshot());
+                }
+                catch (...) {
+                    result->set_exception(std::current_exception());
+                }
+                released.wait();
+                });
+
+            return snapshot_ready.get();
+        }
+
+        void Release() {
+            if (auto release = std::exchange(release_, nullptr)) {
+                release->set_value();
+            }
+        }
+
+    private:
+        std::shared_ptr<std::promise<void>> release_;
+    };
 }
 
 std::string GetDbUrlFromEnv() {
@@ -48,6 +86,17 @@ std::string GetDbUrlFromEnv() {
 int main(int argc, const char* argv[]) {
     auto args = ParseCommandLine(argc, argv);
 
+    // Сессии создаются позже, поэтому выбор памяти для сущностей подействует на все
+    if (args.entity_memory == "huge-pages") {
+        memory::ConfigureEntityMemory(memory::EntityMemory::HUGE_PAGES);
+    }
+    else if (args.entity_memory == "hugetlb") {
+        memory::ConfigureEntityMemory(memory::EntityMemory::HUGETLB);
+    }
+    else {
+        memory::ConfigureEntityMemory(memory::EntityMemory::HEAP);
+    }
+
     try {
         auto game_ptr = json_loader::LoadGame(args.config_file);
         auto& game = *game_ptr;
@@ -59,19 +108,9 @@ int main(int argc, const char* argv[]) {
                 args.state_file,
                 std::chrono::milliseconds(args.save_state_period > 0 ? args.save_state_period : 0)
             );
-
-            serializing_listener->LoadState();
         }
 
         bool game_loop_started = false;
-        if (args.tick_period > 0) {
-            game.SetTickPeriod(args.tick_period);
-            if (args.tick_period > 0) {
-                game.StartGameLoop();
-                game_loop_started = true;
-            }
-            std::cout << "Game loop started..."sv << std::endl;
-        }
 
         auto db_url = GetDbUrlFromEnv();
         auto records = std::make_shared<RecordRepository>(db_url);
@@ -119,17 +158,180 @@ int main(int argc, const char* argv[]) {
             args.www_root,
             args.tick_period == 0,
             args.randomize_spawn_points,
-            serializing_listener.get(),
-            records
+            records,
+            args.early_hints
         );
+        // Автосохранение и ожидающие тика запросы состояния обслуживаются после каждого тика,
+        // будь он от игрового цикла или от /api/v1/game/tick
+        game.SetTickCallback([handler, listener = serializing_listener.get()](uint64_t tick, double delta_time) {
+            if (listener) {
+                listener->OnTick(std::chrono::round<std::chrono::milliseconds>(
+                    std::chrono::duration<double>(delta_time)));
+            }
+            handler->OnGameTick(tick);
+            });
+        // Смена уровня деградации попадает в лог, текущий уровень отдаёт /api/v1/game/metrics
+        game.SetDegradationCallback([](const model::TickBudget& budget) {
+            boost::json::value log_entry = {
+                {"timestamp", http_server::GetCurrentTimestamp()},
+                {"message", "tick budget"},
+                {"data", {
+                    {"level", static_cast<int>(budget.GetLevel())},
+                    {"degradation", model::DegradationLevelToString(budget.GetLevel())},
+                    {"load", budget.GetLoad()}
+                }}
+            };
+            std::cout << boost::json::serialize(log_entry) << std::endl;
+            });
+
+        // Медленная инициализация уже позади: забираем состояние у работающего сервера
+        // или загружаем его из файла
+        std::optional<handoff::Inheritance> inheritance;
+        if (!args.takeover_socket.empty()) {
+            inheritance = handoff::ReceiveFromPredecessor(args.takeover_socket);
+            state_serializer::StateSerializer serializer;
+            serializer.DeserializeGame(game, boost::json::parse(inheritance->state).as_object());
+            inheritance->state.clear();
+            std::cout << "Took over game state from running server" << std::endl;
+        }
+        else if (serializing_listener) {
+            serializing_listener->LoadState();
+        }
 
-        http_server::ServeHttp(ioc, { address, port },
-            [handler](auto&& req, auto&& send) {
-                (*handler)(std::forward<decltype(req)>(req),
-                    std::forward<decltype(send)>(send));
+        if (args.tick_period > 0) {
+            // Период задаётся в миллисекундах, игра хранит его в микросекундах
+            game.SetTickPeriod(static_cast<int64_t>(args.tick_period) * 1000);
+            game.StartGameLoop();
+            game_loop_started = true;
+            std::cout << "Game loop started..."sv << std::endl;
+        }
+
+        // Один трекер на все слушающие сокеты: таймауты простоя и лимит соединений общие
+        auto connections = std::make_shared<http_server::ConnectionTracker>(ioc,
+            http_server::ConnectionTracker::Config{
+                std::chrono::seconds(std::max(1, args.idle_timeout)),
+                args.max_connections,
+                std::max(1u, num_threads)
             });
+        connections->Run();
+
+        auto serve_request = [handler](auto&& req, auto&& send) {
+            (*handler)(std::forward<decltype(req)>(req),
+                std::forward<decltype(send)>(send));
+            };
+
+        // Все слушающие сокеты обслуживаются одними и теми же Listener и Session
+        std::vector<std::shared_ptr<http_server::ListenerBase>> listeners;
+        if (inheritance && !inheritance->sockets.empty()) {
+            for (const auto& socket : inheritance->sockets) {
+                switch (socket.kind) {
+                case handoff::SocketKind::TCP_V4:
+                    listeners.push_back(http_server::ServeHttp(ioc, net::ip::tcp::v4(), socket.fd,
+                        connections, serve_request));
+                    break;
+                case handoff::SocketKind::TCP_V6:
+                    listeners.push_back(http_server::ServeHttp(ioc, net::ip::tcp::v6(), socket.fd,
+                        connections, serve_request));
+                    break;
+                case handoff::SocketKind::UNIX:
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+                    listeners.push_back(http_server::ServeHttp(ioc, net::local::stream_protocol(), socket.fd,
+                        connections, serve_request));
+#endif
+                    break;
+                }
+            }
+        }
+        else {
+            for (const auto& endpoint : args.listen) {
+                if (endpoint.IsUnix()) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+                    std::optional<std::filesystem::perms> permissions;
+                    if (endpoint.unix_mode) {
+                        permissions = static_cast<std::filesystem::perms>(*endpoint.unix_mode);
+                    }
+                    listeners.push_back(http_server::ServeHttp(ioc,
+                        net::local::stream_protocol::endpoint(endpoint.unix_path), permissions,
+                        connections, serve_request));
+                    std::cout << "Server is listening on unix:" << endpoint.unix_path << "..."sv << std::endl;
+#else
+                    throw std::runtime_error("Unix sockets are not supported on this platform");
+#endif
+                }
+                else {
+                    listeners.push_back(http_server::ServeHttp(ioc,
+                        net::ip::tcp::endpoint(net::ip::make_address(endpoint.host), endpoint.port),
+                        connections, serve_request));
+                    std::cout << "Server has started on " << endpoint.host << ":" << endpoint.port
+                        << "..."sv << std::endl;
+                }
+            }
+        }
+
+        if (inheritance) {
+            // Новый процесс уже принимает соединения, старый может завершаться
+            handoff::AcknowledgeTakeover(*inheritance);
+            std::cout << "Server has taken over " << listeners.size() << " listening socket(s)..."sv << std::endl;
+        }
 
-        std::cout << "Server has started on port " << port << "..."sv << std::endl;
+        ApiFreeze api_freeze;
+        // Ограничивает ожидание закрытия соединений после передачи состояния
+        net::steady_timer drain_timer(ioc);
+        std::unique_ptr<handoff::HandoffServer> handoff_server;
+        if (!args.handoff_socket.empty()) {
+            std::vector<int> listen_fds;
+            for (const auto& listener : listeners) {
+                listen_fds.push_back(listener->GetNativeHandle());
+            }
+            handoff_server = std::make_unique<handoff::HandoffServer>(
+                args.handoff_socket,
+                std::move(listen_fds),
+                [&]() {
+                    std::vector<std::future<void>> stopped;
+                    for (const auto& listener : listeners) {
+                        stopped.push_back(listener->StopAccepting());
+                    }
+                    for (auto& done : stopped) {
+                        done.wait();
+                    }
+                    if (game_loop_started) {
+                        game.StopGameLoop();
+                    }
+                    return api_freeze.Freeze(api_strand, [&game] {
+                        state_serializer::StateSerializer serializer;
+                        return boost::json::serialize(serializer.SerializeGame(game));
+                        });
+                },
+                [&](bool handed_off) {
+                    if (handed_off) {
+                        // Запросы, ждущие strand, отклоняются до того, как он будет отпущен:
+                        // иначе запрос на вход успеет создать игрока, о котором новый
+                        // процесс не знает. Клиенты получают 503 и переподключаются уже
+                        // к новому процессу, а этот завершается, когда соединения закроются
+                        handler->RejectApiRequests();
+                        api_freeze.Release();
+                        connections->Drain([&ioc] {
+                            ioc.stop();
+                            });
+                        drain_timer.expires_after(std::chrono::seconds(std::max(1, args.idle_timeout)));
+                        drain_timer.async_wait([&ioc](const sys::error_code& ec) {
+                            if (!ec) {
+                                ioc.stop();
+                            }
+                            });
+                        return;
+                    }
+                    api_freeze.Release();
+                    if (game_loop_started) {
+                        game.StartGameLoop();
+                    }
+                    for (const auto& listener : listeners) {
+                        listener->ResumeAccepting();
+                    }
+                });
+            handoff_server->Start();
+            std::cout << "Waiting for successor on " << args.handoff_socket << std::endl;
+        }
 
         if (args.save_state_period > 0) {
             std::cout << "Game state will be auto-saved to: "
@@ -102,6 +102,30 @@ namespace model {
         }
     }
 
+    void Map::CompileOfficeIndex() {
+        std::vector<collision_detector::StaticItemIndex::Line> lines;
+        lines.reserve(roads_.size());
+        for (const auto& road : roads_) {
+            if (road.IsHorizontal()) {
+                lines.push_back({ true, static_cast<double>(road.GetStart().y) });
+            }
+            else {
+                lines.push_back({ false, static_cast<double>(road.GetStart().x) });
+            }
+        }
+
+        std::vector<collision_detector::Item> items;
+        items.reserve(offices_.size());
+        for (const auto& office : offices_) {
+            // Офисы имеют ширину 0.5 (по условию)
+            items.push_back({ office.GetPosition(), 0.5 });
+        }
+
+        // Игроки имеют ширину 0.6, а от оси дороги отходят не дальше её полуширины
+        const double road_half_width = roads_.empty() ? 0.0 : roads_.front().GetWidth();
+        office_index_ = collision_detector::StaticItemIndex(std::move(items), lines, 0.6, road_half_width);
+    }
+
     std::pair<Position, Position> Map::GetExactMovementBounds() const {
         if (roads_.empty()) {
             return { Position{0.0, 0.0}, Position{0.0, 0.0} };
@@ -476,10 +500,79 @@ namespace model {
     }
 
     void GameSession::AddPlayer(Player player) {
+        // Накопленное время тишины относится только к уже играющим
+        FlushQuietTime();
         players_.push_back(std::move(player));
     }
 
+    bool GameSession::HasMovingDogs() const noexcept {
+        constexpr double EPS = 1e-10;
+        return std::any_of(players_.begin(), players_.end(), [](const Player& player) {
+            auto speed = player.GetDog().GetSpeed();
+            return std::abs(speed.vx) >= EPS || std::abs(speed.vy) >= EPS;
+            });
+    }
+
+    void GameSession::AdvanceQuietTime(double delta_time) {
+        quiet_time_ += delta_time;
+        // Лут появляется и в тишине: его стоимость зависит от числа новых предметов, а не игроков
+        AdvanceLoot(delta_time);
+
+        if (!game_) {
+            return;
+        }
+
+        // Все собаки стоят, поэтому первым на покой уйдёт игрок с наибольшим временем бездействия
+        if (!quiet_retire_deadline_) {
+            double max_idle_time = 0.0;
+            for (const auto& player : players_) {
+                max_idle_time = std::max(max_idle_time, player.GetIdleTime());
+            }
+            quiet_retire_deadline_ = game_->GetDogRetirementTime() - max_idle_time;
+        }
+
+        if (quiet_time_ >= *quiet_retire_deadline_) {
+            FlushQuietTime();
+            RetireInactivePlayers();
+        }
+    }
+
+    void GameSession::FlushQuietTime() {
+        if (quiet_time_ > 0.0) {
+            for (auto& player : players_) {
+                player.AddPlayTime(quiet_time_);
+                player.AddIdleTime(quiet_time_);
+            }
+        }
+        quiet_time_ = 0.0;
+        quiet_retire_deadline_.reset();
+    }
+
     void GameSession::UpdateState(double delta_time) {
+        // Пустая сессия «спит» до подключения игрока
+        if (players_.empty()) {
+            return;
+        }
+
+        // Время тишины истекло до изменения скорости, и все собаки в нём стояли
+        if (wake_requested_->exchange(false, std::memory_order_acq_rel)) {
+            FlushQuietTime();
+            quiet_ = false;
+        }
+
+        // Активная сессия затихает, когда остановилась последняя собака
+        if (!quiet_) {
+            quiet_ = !HasMovingDogs();
+        }
+
+        // Никто не движется: столкновений нет, остаётся только время
+        if (quiet_) {
+            AdvanceQuietTime(delta_time);
+            return;
+        }
+
+        FlushQuietTime();
+
         // Обновляем игровое время и время бездействия
         for (auto& player : players_) {
             // Общее время в игре
@@ -500,39 +593,7 @@ namespace model {
             }
         }
 
-        // Генерация нового лута
-        if (loot_generator_) {
-            auto time_delta = std::chrono::duration<double>(delta_time);
-            auto new_loot_count = loot_generator_->Generate(
-                std::chrono::duration_cast<loot_gen::LootGenerator::TimeInterval>(time_delta),
-                loots_.size(),
-                players_.size()
-            );
-
-            // Создаем новые предметы лута
-            for (unsigned i = 0; i < new_loot_count; ++i) {
-                // Генерируем случайный тип лута
-                std::uniform_int_distribution<size_t> dist(0, map_->GetLootTypesCount() - 1);
-                size_t type = dist(random_engine);
-
-                // Получаем случайную позицию на карте
-                Position pos = map_->GetRandomPosition();
-
-                // Получаем стоимость лута из конфигурации карты
-                int value = 0;
-                auto loot_types = map_->GetLootTypes();
-                if (type < loot_types.size()) {
-                    auto& loot_type = loot_types[type].as_object();
-                    if (loot_type.contains("value")) {
-                        value = static_cast<int>(loot_type.at("value").as_int64());
-                    }
-                }
-
-                // Создаем лут с уникальным ID и стоимостью
-                Loot loot(Loot::Id{ next_loot_id_++ }, type, pos, value);
-                loots_.push_back(std::move(loot));
-            }
-        }
+        AdvanceLoot(delta_time);
 
         // Сохраняем предыдущие позиции игроков
         for (auto& player : players_) {
@@ -563,30 +624,70 @@ namespace model {
         RetireInactivePlayers();
     }
 
-    void GameSession::RetireInactivePlayers() {
-        if (!game_) {
-            return;
+    void GameSession::AdvanceLoot(double delta_time) {
+        // При нехватке времени на тик лут генерируется реже, за всё накопленное время
+        pending_loot_time_ += delta_time;
+        if (!game_ || !game_->GetTickBudget().IsDegraded(DegradationLevel::DEFER_LOOT)
+            || pending_loot_time_ >= TickBudget::DEFERRED_LOOT_INTERVAL) {
+            GenerateLoot(pending_loot_time_);
+            pending_loot_time_ = 0.0;
         }
+    }
 
-        const double retire_time = game_->GetDogRetirementTime();
+    void GameSession::GenerateLoot(double delta_time) {
+        if (!loot_generator_) {
+            return;
+        }
 
-        std::vector<Player> active_players;
-        active_players.reserve(players_.size());
+        auto time_delta = std::chrono::duration<double>(delta_time);
+        auto new_loot_count = loot_generator_->Generate(
+            std::chrono::duration_cast<loot_gen::LootGenerator::TimeInterval>(time_delta),
+            loots_.size(),
+            players_.size()
+        );
 
-        for (auto& player : players_) {
-            if (player.GetIdleTime() >= retire_time) {
-                // игрок уходит на покой: уведомляем Game
-                if (game_) {
-                    game_->OnPlayerRetired(player);
+        // Создаем новые предметы лута
+        for (unsigned i = 0; i < new_loot_count; ++i) {
+            // Генерируем случайный тип лута
+            std::uniform_int_distribution<size_t> dist(0, map_->GetLootTypesCount() - 1);
+            size_t type = dist(random_engine);
+
+            // Получаем случайную позицию на карте
+            Position pos = map_->GetRandomPosition();
+
+            // Получаем стоимость лута из конфигурации карты
+            int value = 0;
+            auto loot_types = map_->GetLootTypes();
+            if (type < loot_types.size()) {
+                auto& loot_type = loot_types[type].as_object();
+                if (loot_type.contains("value")) {
+                    value = static_cast<int>(loot_type.at("value").as_int64());
                 }
-                // НЕ переносим его в active_players
-            }
-            else {
-                active_players.push_back(std::move(player));
             }
+
+            // Создаем лут с уникальным ID и стоимостью
+            Loot loot(Loot::Id{ next_loot_id_++ }, type, pos, value);
+            loots_.push_back(std::move(loot));
         }
+    }
 
-        players_.swap(active_players);
+    void GameSession::RetireInactivePlayers() {
+        if (!game_) {
+            return;
+        }
+
+        const double retire_time = game_->GetDogRetirementTime();
+
+        // Удаляем на месте: временный массив размером с сессию на каждом тике
+        // означал бы новое отображение памяти для крупных сессий
+        std::erase_if(players_, [this, retire_time](const Player& player) {
+            if (player.GetIdleTime() < retire_time) {
+                return false;
+            }
+            // игрок уходит на покой: уведомляем Game
+            game_->OnPlayerRetired(player);
+            return true;
+            });
     }
 
 
@@ -607,7 +708,7 @@ namespace model {
         // Провайдер для обнаружения сбора предметов
         class LootProvider : public collision_detector::ItemGathererProvider {
         public:
-            LootProvider(const std::vector<Loot>& loots, const std::vector<Player>& players)
+            LootProvider(const Loots& loots, const Players& players)
                 : loots_(loots), players_(players) {
             }
 
@@ -631,48 +732,23 @@ namespace model {
             }
 
         private:
-            const std::vector<Loot>& loots_;
-            const std::vector<Player>& players_;
-        };
-
-        // Провайдер для обнаружения возвращения на базу (офисы)
-        class OfficeProvider : public collision_detector::ItemGathererProvider {
-        public:
-            OfficeProvider(const std::vector<Office>& offices, const std::vector<Player>& players)
-                : offices_(offices), players_(players) {
-            }
-
-            size_t ItemsCount() const override {
-                return offices_.size();
-            }
-
-            collision_detector::Item GetItem(size_t idx) const override {
-                // Офисы имеют ширину 0.5 (по условию)
-                return { offices_[idx].GetPosition(), 0.5 };
-            }
-
-            size_t GatherersCount() const override {
-                return players_.size();
-            }
-
-            collision_detector::Gatherer GetGatherer(size_t idx) const override {
-                const auto& dog = players_[idx].GetDog();
-                // Игроки имеют ширину 0.6 (по условию)
-                return { dog.GetPreviousPosition(), dog.GetPosition(), 0.6 };
-            }
-
-        private:
-            const std::vector<Office>& offices_;
-            const std::vector<Player>& players_;
+            const Loots& loots_;
+            const Players& players_;
         };
 
         // Находим события сбора предметов
         LootProvider loot_provider(loots_, players_);
         auto loot_events = collision_detector::FindGatherEvents(loot_provider);
 
-        // Находим события возвращения на базу
-        OfficeProvider office_provider(map_->GetOffices(), players_);
-        auto office_events = collision_detector::FindGatherEvents(office_provider);
+        // Находим события возвращения на базу. Офисы неподвижны, поэтому
+        // ищем их по индексу вдоль линии дороги, по которой идёт собака
+        std::vector<collision_detector::GatheringEvent> office_events;
+        const auto& office_index = map_->GetOfficeIndex();
+        for (size_t idx = 0; idx < players_.size(); ++idx) {
+            const auto& dog = players_[idx].GetDog();
+            // Игроки имеют ширину 0.6 (по условию)
+            office_index.FindEvents(idx, { dog.GetPreviousPosition(), dog.GetPosition(), 0.6 }, office_events);
+        }
 
         // Собираем все события в один список
         std::vector<GameEvent> all_events;
@@ -751,6 +827,8 @@ namespace model {
     
 
     void Game::AddMap(Map map) {
+        map.CompileOfficeIndex();
+
         const size_t index = maps_.size();
         if (auto [it, inserted] = map_id_to_index_.emplace(map.GetId(), index); !inserted) {
             throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
@@ -797,10 +875,22 @@ namespace model {
             last_tick_time = current_time;
 
             // Обновляем состояние игры
-            UpdateState(delta_time);
+            const auto tick = AdvanceSessions(delta_time);
+
+            // Стоимость тика определяет, какую некритичную работу пора урезать.
+            // Подписчики тика (автосохранение, ответы клиентам) в неё не входят
+            auto tick_cost = steady_clock::now() - current_time;
+            if (tick_budget_.OnTick(tick_cost, update_period_) && degradation_callback_) {
+                degradation_callback_(tick_budget_);
+            }
+            NotifyTick(tick, delta_time);
 
-            std::this_thread::sleep_for(update_period_);
+            // Спим до начала следующего периода, а не полный период после тика
+            auto next_tick_time = current_time + update_period_;
+            next_tick_time_.store(next_tick_time.time_since_epoch().count(), std::memory_order_relaxed);
+            std::this_thread::sleep_until(next_tick_time);
         }
+        next_tick_time_.store(0, std::memory_order_relaxed);
     }
 
     GameSession* Game::FindSessionByMapId(const Map::Id& map_id) {
@@ -848,9 +938,26 @@ namespace model {
     }
 
     void Game::UpdateState(double delta_time) {
+        NotifyTick(AdvanceSessions(delta_time), delta_time);
+    }
+
+    uint64_t Game::AdvanceSessions(double delta_time) {
         for (auto& session : sessions_) {
+            // Сессии без игроков не тратят время тика
+            if (session.IsHibernating()) {
+                continue;
+            }
             session.UpdateState(delta_time);
         }
+
+        // Тик опубликован: ожидающие его клиенты могут забирать состояние
+        return tick_number_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+
+    void Game::NotifyTick(uint64_t tick, double delta_time) {
+        if (tick_callback_) {
+            tick_callback_(tick, delta_time);
+        }
     }
 
     void Game::SetTickPeriod(int64_t period) {
@@ -860,6 +967,9 @@ namespace model {
     void Game::StartGameLoop() {
         if (game_loop_running_) return;
 
+        // Перезапуск после неудачной передачи состояния начинается без старой деградации
+        tick_budget_.Reset();
+
         game_loop_running_ = true;
         game_loop_thread_ = std::thread([this]() { GameLoop(); });
     }
@@ -10,11 +10,15 @@
 #include <iostream>
 #include <boost/json.hpp>
 #include <compare>
+#include <optional>
+#include <memory_resource>
 
 #include "tagged.h"
 #include "token.h"
 #include "loot_generator.h"
 #include "collision_detector.h"
+#include "tick_budget.h"
+#include "huge_page_resource.h"
 
 namespace model {
 
@@ -223,6 +227,13 @@ namespace model {
         MoveResult MoveDog(Position start, Speed speed, double delta_time) const;
         bool IsAtBoundary(Position pos, Speed speed) const;
 
+        // Раскладывает офисы по линиям дорог. Вызывается, когда карта полностью загружена
+        void CompileOfficeIndex();
+
+        const collision_detector::StaticItemIndex& GetOfficeIndex() const noexcept {
+            return office_index_;
+        }
+
     private:
         using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
 
@@ -238,6 +249,7 @@ namespace model {
         size_t loot_types_count_ = 0;
         boost::json::array loot_types_;
         size_t bag_capacity_ = 3;
+        collision_detector::StaticItemIndex office_index_;
     };
 
     class Dog {
@@ -414,6 +426,9 @@ namespace model {
     public:
         using Id = util::Tagged<std::string, GameSession>;
         using MapIdHasher = util::TaggedHasher<Map::Id>;
+        // Массивы сущностей сессии размещаются в памяти для сущностей (см. memory::GetEntityResource)
+        using Players = std::pmr::vector<Player>;
+        using Loots = std::pmr::vector<Loot>;
 
         explicit GameSession(Id id, const Map* map, Game* game) noexcept
             : id_(std::move(id))
@@ -429,15 +444,15 @@ namespace model {
             return map_;
         }
 
-        const std::vector<Player>& GetPlayers() const noexcept {
+        const Players& GetPlayers() const noexcept {
             return players_;
         }
 
-        std::vector<Player>& GetPlayers() noexcept {
+        Players& GetPlayers() noexcept {
             return players_;
         }
 
-        const std::vector<Loot>& GetLoots() const noexcept {
+        const Loots& GetLoots() const noexcept {
             return loots_;
         
         }
@@ -454,6 +469,17 @@ namespace model {
             return next_loot_id_;
         }
 
+        // Сессия без игроков не тикает, пока кто-нибудь не подключится
+        bool IsHibernating() const noexcept {
+            return players_.empty();
+        }
+
+        // Вызывается при изменении скорости собаки из любого потока. Сессия выходит
+        // из тишины на ближайшем тике, в потоке игрового цикла
+        void Wake() noexcept {
+            wake_requested_->store(true, std::memory_order_release);
+        }
+
         void UpdateState(double delta_time);
 
         void HandleCollisions();
@@ -469,12 +495,27 @@ namespace model {
         Id id_;
         const Map* map_;
         Game* game_;
-        std::vector<Player> players_;
-        std::vector<Loot> loots_;
+        Players players_{ memory::GetEntityResource() };
+        Loots loots_{ memory::GetEntityResource() };
         size_t next_loot_id_ = 0;
         std::unique_ptr<loot_gen::LootGenerator> loot_generator_;
         std::unordered_map<Map::Id, boost::json::array, MapIdHasher> map_id_to_loot_types_;
 
+        // Состояние тихой сессии: время копится одним числом и разносится
+        // по игрокам только при выходе из тишины, добавлении игрока или отставке.
+        // Из тишины сессию выводит только Wake, сканировать собак каждый тик не нужно
+        bool quiet_ = false;
+        double quiet_time_ = 0.0;
+        std::optional<double> quiet_retire_deadline_;
+        double pending_loot_time_ = 0.0;
+        // Сессии хранятся в векторе и перемещаются, поэтому флаг лежит отдельно
+        std::unique_ptr<std::atomic<bool>> wake_requested_ = std::make_unique<std::atomic<bool>>(false);
+
+        bool HasMovingDogs() const noexcept;
+        void AdvanceQuietTime(double delta_time);
+        void FlushQuietTime();
+        void AdvanceLoot(double delta_time);
+        void GenerateLoot(double delta_time);
         void RetireInactivePlayers();
     };
 
@@ -485,6 +526,11 @@ namespace model {
         using MapIdHasher = util::TaggedHasher<Map::Id>;
         using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
         using RetiredPlayerCallback = std::function<void(const Player&)>;
+        // Вызывается после каждого тика (по таймеру или ручного) с его номером и длительностью,
+        // в потоке, который выполнил тик. В стоимость тика для TickBudget не входит
+        using TickCallback = std::function<void(uint64_t tick, double delta_time)>;
+        // Вызывается игровым циклом при смене уровня деградации
+        using DegradationCallback = std::function<void(const TickBudget&)>;
 
 
         const Maps& GetMaps() const noexcept {
@@ -514,10 +560,37 @@ namespace model {
             return dog_retirement_time_;
         }
 
+        // Контроллер бюджета тика: по нему некритичная работа решает, не пора ли уступить
+        const TickBudget& GetTickBudget() const noexcept {
+            return tick_budget_;
+        }
+
         void SetRetiredPlayerCallback(RetiredPlayerCallback cb) {
             retired_player_callback_ = std::move(cb);
         }
 
+        void SetTickCallback(TickCallback cb) {
+            tick_callback_ = std::move(cb);
+        }
+
+        void SetDegradationCallback(DegradationCallback cb) {
+            degradation_callback_ = std::move(cb);
+        }
+
+        // Номер последнего опубликованного тика
+        uint64_t GetTickNumber() const noexcept {
+            return tick_number_.load(std::memory_order_acquire);
+        }
+
+        // Когда игровой цикл выполнит следующий тик. nullopt, если тики задаются вручную
+        std::optional<std::chrono::steady_clock::time_point> GetNextTickTime() const noexcept {
+            auto ticks = next_tick_time_.load(std::memory_order_relaxed);
+            if (ticks == 0) {
+                return std::nullopt;
+            }
+            return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(ticks));
+        }
+
         void OnPlayerRetired(const Player& player) const {
             if (retired_player_callback_) {
                 retired_player_callback_(player);
@@ -544,6 +617,9 @@ namespace model {
     private:
 
         void GameLoop();
+        // Продвигает сессии и публикует тик. Возвращает номер опубликованного тика
+        uint64_t AdvanceSessions(double delta_time);
+        void NotifyTick(uint64_t tick, double delta_time);
 
         std::vector<Map> maps_;
         MapIdToIndex map_id_to_index_;
@@ -555,6 +631,12 @@ namespace model {
         std::chrono::microseconds update_period_;
         double dog_retirement_time_ = 60.0;
         RetiredPlayerCallback retired_player_callback_;
+        TickBudget tick_budget_;
+        TickCallback tick_callback_;
+        DegradationCallback degradation_callback_;
+        std::atomic<uint64_t> tick_number_{ 0 };
+        // Время следующего тика в единицах steady_clock, 0 - игровой цикл не запущен
+        std::atomic<std::chrono::steady_clock::rep> next_tick_time_{ 0 };
     };
 
 }  // namespace model
\ No newline at end of file
@@ -93,6 +93,82 @@ namespace http_handler {
         };
     }
 
+    void RequestHandler::OnGameTick(uint64_t tick) {
+        // Барьер в паре с ParkUntilTick: либо игровой цикл увидит вставший в очередь запрос,
+        // либо запрос увидит новый тик
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_count_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        net::post(api_strand_, [self = shared_from_this(), tick] {
+            self->CompleteParked(tick);
+            });
+    }
+
+    void RequestHandler::RejectApiRequests() {
+        api_rejected_.store(true, std::memory_order_release);
+        // Игровой цикл уже остановлен, поэтому ожидающих тика завершаем сами
+        net::post(api_strand_, [self = shared_from_this()] {
+            self->CompleteParked(std::numeric_limits<uint64_t>::max());
+            });
+    }
+
+    bool RequestHandler::ParkUntilTick(uint64_t after_tick, std::function<void()> complete) {
+        if (after_tick != game_.GetTickNumber()) {
+            return false;
+        }
+
+        const bool was_empty = parked_requests_.empty();
+        parked_requests_.push_back({ after_tick, std::chrono::steady_clock::now() + LONG_POLL_TIMEOUT,
+            std::move(complete) });
+        parked_count_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // Тик мог выйти, пока запрос вставал в очередь, и игровой цикл о нём не сообщит
+        if (const auto tick = game_.GetTickNumber(); tick != after_tick) {
+            CompleteParked(tick);
+        }
+        else if (was_empty) {
+            ScheduleLongPollTimeout();
+        }
+        return true;
+    }
+
+    void RequestHandler::CompleteParked(uint64_t tick) {
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<std::function<void()>> ready;
+        while (!parked_requests_.empty()
+            && (parked_requests_.front().after_tick < tick || parked_requests_.front().deadline <= now)) {
+            ready.push_back(std::move(parked_requests_.front().complete));
+            parked_requests_.pop_front();
+        }
+        if (ready.empty()) {
+            return;
+        }
+        parked_count_.fetch_sub(ready.size(), std::memory_order_relaxed);
+
+        if (parked_requests_.empty()) {
+            long_poll_timer_.cancel();
+        }
+        else {
+            ScheduleLongPollTimeout();
+        }
+
+        // Ответ собирается здесь же, в API strand, как и для обычного запроса состояния
+        for (auto& complete : ready) {
+            complete();
+        }
+    }
+
+    void RequestHandler::ScheduleLongPollTimeout() {
+        long_poll_timer_.expires_at(parked_requests_.front().deadline);
+        long_poll_timer_.async_wait([self = shared_from_this()](const boost::system::error_code& ec) {
+            if (!ec) {
+                self->CompleteParked(self->game_.GetTickNumber());
+            }
+            });
+    }
+
     std::string RequestHandler::GetMimeType(const std::string& file_path) const {
         fs::path path(file_path);
         std::string extension = path.extension().string();
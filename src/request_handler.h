@@ -2,13 +2,20 @@
 #include "http_server.h"
 #include "model.h"
 #include "token.h"
-#include "application_listener.h"
 #include "record_repository.h"
+#include "asset_manifest.h"
 
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
+#include <atomic>
+#include <charconv>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <optional>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
@@ -32,17 +39,23 @@ namespace http_handler {
         RequestHandler(model::Game& game, Strand api_strand,
             std::string www_root, bool manual_tick_enabled,
             bool randomize_spawn_points,
-            app::ApplicationListener* tick_listener,
-            std::shared_ptr<RecordRepository> record_repo)
+            std::shared_ptr<RecordRepository> record_repo,
+            bool early_hints = false)
             : game_(game)
             , api_strand_(api_strand)
             , static_path_(std::move(www_root))
             , manual_tick_enabled_(manual_tick_enabled)
             , randomize_spawn_points_(randomize_spawn_points)
-            , tick_listener_(tick_listener)
-            , record_repo_(std::move(record_repo)) {
+            , record_repo_(std::move(record_repo))
+            , asset_manifest_(assets::AssetManifest::Build(static_path_, game))
+            , early_hints_(early_hints)
+            , long_poll_timer_(api_strand_) {
         }
 
+        // Сколько запрос состояния с ?afterTick ждёт следующего тика, прежде чем
+        // получить текущее состояние
+        static constexpr std::chrono::steady_clock::duration LONG_POLL_TIMEOUT = std::chrono::seconds{ 10 };
+
         RequestHandler(const RequestHandler&) = delete;
         RequestHandler& operator=(const RequestHandler&) = delete;
 
@@ -61,8 +74,31 @@ namespace http_handler {
 
                     auto handle = [self = shared_from_this(), send = std::forward<Send>(send),
                         req_copy, version, keep_alive]() mutable {
+                        // Состояние уже у нового процесса: запрос не выполняем,
+                        // а просим клиента повторить его на новом соединении
+                        if (self->api_rejected_.load(std::memory_order_acquire)) {
+                            return send(self->MakeUnavailableResponse(*req_copy));
+                        }
                         try {
                             // Этот код выполняется внутри strand
+                            if (auto after_tick = self->GetLongPollTick(*req_copy)) {
+                                auto complete = [self, send, req_copy]() mutable {
+                                    if (self->api_rejected_.load(std::memory_order_acquire)) {
+                                        return send(self->MakeUnavailableResponse(*req_copy));
+                                    }
+                                    try {
+                                        send(self->HandleApiRequest(*req_copy));
+                                    }
+                                    catch (const std::exception&) {
+                                        send(self->MakeErrorResponse(
+                                            *req_copy, http::status::internal_server_error,
+                                            "Internal server error", "internalError"));
+                                    }
+                                    };
+                                if (self->ParkUntilTick(*after_tick, std::move(complete))) {
+                                    return;
+                                }
+                            }
                             auto response = self->HandleApiRequest(*req_copy);
                             return send(std::move(response));
                         }
@@ -76,6 +112,13 @@ namespace http_handler {
                     return net::dispatch(api_strand_, std::move(handle));
                 }
 
+                // Пока готовится страница, браузер уже может загружать её ресурсы
+                if (early_hints_ && req.version() >= 11 && req.method() == http::verb::get) {
+                    if (auto links = GetPreloadLinks(req); !links.empty()) {
+                        send(MakeEarlyHintsResponse(req, links));
+                    }
+                }
+
                 // Статические файлы обрабатываем как раньше
                 auto response = HandleNonApiRequest(std::move(req));
                 return send(std::move(response));
@@ -89,6 +132,15 @@ namespace http_handler {
             }
         }
 
+        // Запросы, которые ещё ждут API strand или тика, больше не выполняются:
+        // на них отвечаем 503 и закрываем соединение. Вызывается, когда снимок
+        // состояния передан новому процессу, до того как strand будет отпущен
+        void RejectApiRequests();
+
+        // Вызывается игровым циклом после публикации тика. Ожидающие запросы
+        // завершаются в API strand, сам игровой цикл их не обслуживает
+        void OnGameTick(uint64_t tick);
+
         template <typename Body, typename Allocator>
         StringResponse HandleGameTick(const http::request<Body, http::basic_fields<Allocator>>& req) {
             if (req.method() != http::verb::post) {
@@ -129,15 +181,9 @@ namespace http_handler {
                 // Convert milliseconds -> microseconds for Game::SetTickPeriod
                 game_.SetTickPeriod(time_delta_ms * 1000);
 
-                // Advance game state
+                // Advance game state (tick callback notifies listeners)
                 game_.UpdateState(delta_time);
 
-                // Notify listener in milliseconds
-                if (tick_listener_) {
-                    auto delta_ms = std::chrono::milliseconds(time_delta_ms);
-                    tick_listener_->OnTick(delta_ms);
-                }
-
                 json::value response_json = json::object{};
                 auto response = MakeJsonResponse(req, http::status::ok, json::serialize(response_json));
                 response.set(http::field::cache_control, "no-cache");
@@ -158,9 +204,35 @@ namespace http_handler {
         fs::path static_path_ = "static";
         bool manual_tick_enabled_;
         bool randomize_spawn_points_;
-        app::ApplicationListener* tick_listener_ = nullptr;
         std::shared_ptr<RecordRepository> record_repo_;
 
+        // Последнее собранное состояние каждой сессии, используется только на API strand
+        struct PublishedState {
+            std::string body;
+            std::chrono::steady_clock::time_point built_at;
+            uint64_t tick = 0;
+        };
+        std::unordered_map<std::string, PublishedState> published_states_;
+
+        // Ресурсы страниц и карт для заголовков Link: rel=preload
+        assets::AssetManifest asset_manifest_;
+        bool early_hints_;
+
+        // Запросы состояния с ?afterTick=N, ожидающие тика N+1. Номера тиков и дедлайны
+        // не убывают в порядке поступления, поэтому завершаются всегда запросы из начала очереди.
+        // Используется только на API strand, поток при ожидании не занимается
+        struct ParkedRequest {
+            uint64_t after_tick;
+            std::chrono::steady_clock::time_point deadline;
+            std::function<void()> complete;
+        };
+        std::deque<ParkedRequest> parked_requests_;
+        // Читается игровым циклом без перехода в strand
+        std::atomic<size_t> parked_count_{ 0 };
+        // Один таймер на все ожидающие запросы, взведён на дедлайн самого старого
+        net::steady_timer long_poll_timer_;
+        std::atomic<bool> api_rejected_{ false };
+
         std::string GetMimeType(const std::string& file_path) const;
         json::value CreateLootJson(const model::Loot& loot);
 
@@ -246,7 +318,7 @@ namespace http_handler {
             }
 
             auto body = json::serialize(arr);
-            auto response = MakeJsonResponse(req, http::status::ok, body);
+            auto response = MakeJsonResponse(req, http::status::ok, std::move(body));
             response.set(http::field::cache_control, "no-cache");
             // Content-Type и Content-Length выставит MakeJsonResponse/prepare_payload
 
@@ -255,6 +327,59 @@ namespace http_handler {
 
 
 
+        std::optional<uint64_t> ParseAfterTick(std::string_view target) const {
+            auto params = ParseQuery(target);
+            auto it = params.find("afterTick");
+            if (it == params.end()) {
+                return std::nullopt;
+            }
+            const auto& value = it->second;
+            uint64_t tick = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), tick);
+            if (ec != std::errc{} || ptr != value.data() + value.size()) {
+                return std::nullopt;
+            }
+            return tick;
+        }
+
+        // Номер тика, после которого клиент хочет получить состояние. Ожидать имеет смысл
+        // только корректному запросу известного игрока, остальные обрабатываются сразу
+        template <typename Body, typename Allocator>
+        std::optional<uint64_t> GetLongPollTick(const http::request<Body, http::basic_fields<Allocator>>& req) const {
+            const auto target = std::string_view(req.target());
+            if (req.method() != http::verb::get || target.substr(0, target.find('?')) != "/api/v1/game/state") {
+                return std::nullopt;
+            }
+            auto after_tick = ParseAfterTick(target);
+            if (!after_tick) {
+                return std::nullopt;
+            }
+
+            auto auth_header = req.find(http::field::authorization);
+            if (auth_header == req.end()) {
+                return std::nullopt;
+            }
+            const auto auth_value = std::string_view(auth_header->value());
+            if (auth_value.length() != 7 + 32 || !auth_value.starts_with("Bearer ")
+                || !std::all_of(auth_value.begin() + 7, auth_value.end(), [](char c) {
+                    return std::isxdigit(static_cast<unsigned char>(c));
+                    })) {
+                return std::nullopt;
+            }
+            if (!game_.FindPlayerByToken(Token{ std::string(auth_value.substr(7)) })) {
+                return std::nullopt;
+            }
+            return after_tick;
+        }
+
+        // Откладывает ответ до тика after_tick + 1. Возвращает false, если ждать нечего:
+        // тик уже опубликован или клиент пришёл с номером из будущего (например, после
+        // перезапуска сервера) - тогда ответ нужен сразу, чтобы клиент узнал текущий тик
+        bool ParkUntilTick(uint64_t after_tick, std::function<void()> complete);
+        // Завершает запросы, дождавшиеся тика, и запросы с истёкшим временем ожидания
+        void CompleteParked(uint64_t tick);
+        void ScheduleLongPollTimeout();
+
         std::unordered_map<std::string, std::string> ParseQuery(std::string_view target) const {
             std::unordered_map<std::string, std::string> params;
 
@@ -429,6 +554,10 @@ namespace http_handler {
                         "Invalid move direction", "invalidArgument");
                 }
 
+                // Тихая сессия не следит за собаками сама, её нужно разбудить
+                if (auto session = game_.FindSessionByMapId(map_id)) {
+                    session->Wake();
+                }
 
                 json::value response_json = json::object{};
                 auto response = MakeJsonResponse(req, http::status::ok, json::serialize(response_json));
@@ -466,7 +595,7 @@ namespace http_handler {
                 return MakeMethodNotAllowedResponse(req, { "GET", "HEAD" });
             }
             // GET /api/v1/game/state
-            else if (target == "/api/v1/game/state") {
+            else if (path == "/api/v1/game/state") {
                 if (method == http::verb::get || method == http::verb::head) {
                     return HandleGetGameState(req);
                 }
@@ -506,12 +635,63 @@ namespace http_handler {
                 }
                 return MakeMethodNotAllowedResponse(req, { "GET", "HEAD" });
             }
+            // GET /api/v1/game/metrics
+            else if (target == "/api/v1/game/metrics") {
+                if (method == http::verb::get || method == http::verb::head) {
+                    return HandleGetMetrics(req);
+                }
+                return MakeMethodNotAllowedResponse(req, { "GET", "HEAD" });
+            }
             return MakeErrorResponse(req, http::status::bad_request, "Invalid request", "badRequest");
         }
 
         template <typename Body, typename Allocator>
         StringResponse HandleNonApiRequest(http::request<Body, http::basic_fields<Allocator>>&& req) {
-            return HandleStaticRequest(req);
+            auto response = HandleStaticRequest(req);
+            if (response.result() == http::status::ok) {
+                if (auto links = GetPreloadLinks(req); !links.empty()) {
+                    response.set(http::field::link, links);
+                }
+            }
+            return response;
+        }
+
+        // Подсказки о предзагрузке для запрошенной страницы. Карту страница игры
+        // берёт из cookie mapId, поэтому и ресурсы карты определяем по ней
+        template <typename Body, typename Allocator>
+        std::string GetPreloadLinks(const http::request<Body, http::basic_fields<Allocator>>& req) const {
+            auto path = std::string_view(req.target());
+            path = path.substr(0, path.find('?'));
+            if (path.empty() || path == "/") {
+                path = "/index.html";
+            }
+
+            std::string_view map_id;
+            if (auto cookie = req.find(http::field::cookie); cookie != req.end()) {
+                const auto cookies = std::string_view(cookie->value());
+                constexpr std::string_view map_cookie = "mapId=";
+                for (size_t pos = cookies.find(map_cookie); pos != std::string_view::npos;
+                    pos = cookies.find(map_cookie, pos + 1)) {
+                    if (pos == 0 || cookies[pos - 1] == ' ' || cookies[pos - 1] == ';') {
+                        map_id = cookies.substr(pos + map_cookie.size());
+                        map_id = map_id.substr(0, map_id.find(';'));
+                        break;
+                    }
+                }
+            }
+
+            return asset_manifest_.GetLinkHeader(path.substr(1), map_id);
+        }
+
+        template <typename Body, typename Allocator>
+        http::response<http::empty_body> MakeEarlyHintsResponse(
+            const http::request<Body, http::basic_fields<Allocator>>& req, const std::string& links) const {
+            http::response<http::empty_body> response;
+            response.result(103);
+            response.reason("Early Hints");
+            response.version(req.version());
+            response.set(http::field::link, links);
+            return response;
         }
 
         template <typename Body, typename Allocator>
@@ -675,6 +855,23 @@ namespace http_handler {
             return response;
         }
 
+        // Нагрузка игрового цикла: сглаженная доля периода, которую занимает тик,
+        // и текущий уровень деградации
+        template <typename Body, typename Allocator>
+        StringResponse HandleGetMetrics(const http::request<Body, http::basic_fields<Allocator>>& req) {
+            const auto& budget = game_.GetTickBudget();
+            json::object metrics_json{
+                {"tick", game_.GetTickNumber()},
+                {"tickLoad", budget.GetLoad()},
+                {"degradationLevel", static_cast<int>(budget.GetLevel())},
+                {"degradation", model::DegradationLevelToString(budget.GetLevel())}
+            };
+            auto response = MakeJsonResponse(req, http::status::ok,
+                req.method() == http::verb::head ? "" : json::serialize(metrics_json));
+            response.set(http::field::cache_control, "no-cache");
+            return response;
+        }
+
         StringResponse HandleGetMaps(const StringRequest& req) {
             auto maps_json = CreateMapListJson();
             auto response = MakeJsonResponse(req, http::status::ok,
@@ -761,6 +958,24 @@ namespace http_handler {
                 return MakeUnknownTokenResponse(req);
             }
 
+            // Под перегрузкой состояние сессии публикуется реже: отдаём недавно собранное
+            const bool throttled = game_.GetTickBudget().IsDegraded(model::DegradationLevel::THROTTLE_PUBLICATION);
+            const auto now = std::chrono::steady_clock::now();
+            const auto tick = game_.GetTickNumber();
+            // Ответ на ?afterTick=N обязан быть новее тика N, иначе клиент сразу придёт снова
+            const auto after_tick = ParseAfterTick(std::string_view(req.target()));
+            const auto published = published_states_.find(*session->GetId());
+            if (throttled && published != published_states_.end()
+                && now - published->second.built_at < model::TickBudget::DEGRADED_PUBLICATION_INTERVAL
+                && (!after_tick || published->second.tick > *after_tick)) {
+                auto body = published->second.body;
+                AppendNextTickIn(body, now);
+                auto response = MakeJsonResponse(req, http::status::ok,
+                    req.method() == http::verb::head ? "" : std::move(body));
+                response.set(http::field::cache_control, "no-cache");
+                return response;
+            }
+
             // Формируем состояние игры
             json::object players_json;
             for (const auto& session_player : session->GetPlayers()) {
@@ -805,15 +1020,39 @@ namespace http_handler {
 
             json::object state_json = {
                 {"players", players_json},
-                { "lostObjects", lost_objects_json }
+                { "lostObjects", lost_objects_json },
+                {"tick", tick}
             };
+            auto body = json::serialize(state_json);
+            // Копию тела держим, только пока публикация урезана. В копии нет nextTickIn:
+            // он добавляется к каждому ответу заново
+            if (throttled) {
+                published_states_[*session->GetId()] = PublishedState{ body, now, tick };
+            }
+            else if (published != published_states_.end()) {
+                published_states_.erase(published);
+            }
+            AppendNextTickIn(body, now);
 
             auto response = MakeJsonResponse(req, http::status::ok,
-                req.method() == http::verb::head ? "" : json::serialize(state_json));
+                req.method() == http::verb::head ? "" : std::move(body));
             response.set(http::field::cache_control, "no-cache");
             return response;
         }
 
+        // Дописывает в JSON-объект состояния, через сколько миллисекунд ожидается следующий тик,
+        // если тики идут по таймеру
+        void AppendNextTickIn(std::string& state_body, std::chrono::steady_clock::time_point now) const {
+            auto next_tick = game_.GetNextTickTime();
+            if (!next_tick || state_body.empty() || state_body.back() != '}') {
+                return;
+            }
+            const auto next_tick_in = std::max<int64_t>(0,
+                std::chrono::duration_cast<std::chrono::milliseconds>(*next_tick - now).count());
+            state_body.pop_back();
+            state_body += ",\"nextTickIn\":" + std::to_string(next_tick_in) + "}";
+        }
+
         template <typename Body, typename Allocator>
         StringResponse MakeInvalidTokenResponse(
             const http::request<Body, http::basic_fields<Allocator>>& req,
@@ -938,7 +1177,7 @@ namespace http_handler {
         StringResponse MakeJsonResponse(
             const http::request<Body, http::basic_fields<Allocator>>& req,
             http::status status,
-            std::string_view body) {
+            std::string body) {
 
             StringResponse response;
             response.result(status);
@@ -947,7 +1186,7 @@ namespace http_handler {
 
 
             if (req.method() != http::verb::head) {
-                response.body() = std::string(body);
+                response.body() = std::move(body);
             }
 
             response.prepare_payload();
@@ -975,6 +1214,15 @@ namespace http_handler {
             return response;
         }
 
+        template <typename Body, typename Allocator>
+        StringResponse MakeUnavailableResponse(const http::request<Body, http::basic_fields<Allocator>>& req) const {
+            auto response = MakeErrorResponse(req, http::status::service_unavailable,
+                "Server is restarting", "serviceUnavailable");
+            response.set(http::field::retry_after, "1");
+            response.keep_alive(false);
+            return response;
+        }
+
         
 
 
@@ -8,16 +8,34 @@ namespace app {
         std::chrono::milliseconds save_period)
         : game_(game)
         , state_file_(state_file)
-        , save_period_(save_period) {
+        , save_period_(save_period)
+        , writer_([this](std::stop_token stop) { WriteSnapshots(stop); }) {
     }
 
     void SerializingListener::OnTick(std::chrono::milliseconds delta) {
         time_since_last_save_ += delta;
 
+        //    ,     
+        if (game_.GetTickBudget().IsDegraded(model::DegradationLevel::POSTPONE_PERSISTENCE)
+            && time_since_last_save_ < save_period_ * model::TickBudget::MAX_PERSISTENCE_POSTPONE) {
+            return;
+        }
+
         if (time_since_last_save_ >= save_period_) {
+            {
+                //     :    
+                std::lock_guard lock(mutex_);
+                if (pending_snapshot_ || writing_) {
+                    return;
+                }
+            }
             try {
-                serializer_.Serialize(game_, state_file_);
-                std::cout << "Auto-saved game state to: " << state_file_ << std::endl;
+                auto snapshot = serializer_.Capture(game_);
+                {
+                    std::lock_guard lock(mutex_);
+                    pending_snapshot_ = std::move(snapshot);
+                }
+                snapshot_cv_.notify_all();
                 time_since_last_save_ = std::chrono::milliseconds(0);
             }
             catch (const std::exception& ex) {
@@ -26,7 +44,39 @@ namespace app {
         }
     }
 
+    void SerializingListener::WriteSnapshots(std::stop_token stop) {
+        while (true) {
+            state_serializer::StateSerializer::Snapshot snapshot;
+            {
+                std::unique_lock lock(mutex_);
+                if (!snapshot_cv_.wait(lock, stop, [this] { return pending_snapshot_.has_value(); })) {
+                    return;
+                }
+                snapshot = std::move(*pending_snapshot_);
+                pending_snapshot_.reset();
+                writing_ = true;
+            }
+
+            try {
+                serializer_.Write(snapshot, state_file_);
+                std::cout << "Auto-saved game state to: " << state_file_ << std::endl;
+            }
+            catch (const std::exception& ex) {
+                std::cerr << "Failed to auto-save game state: " << ex.what() << std::endl;
+            }
+
+            {
+                std::lock_guard lock(mutex_);
+                writing_ = false;
+            }
+            snapshot_cv_.notify_all();
+        }
+    }
+
     void SerializingListener::SaveNow() {
+        //   - :     
+        std::unique_lock lock(mutex_);
+        snapshot_cv_.wait(lock, [this] { return !pending_snapshot_ && !writing_; });
         try {
             serializer_.Serialize(game_, state_file_);
             std::cout << "Game state saved to: " << state_file_ << std::endl;
@@ -3,10 +3,16 @@
 #include "application_listener.h"
 #include "state_serializer.h"
 #include <chrono>
+#include <condition_variable>
 #include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 namespace app {
 
+    // :     ,   ,
+    //         
     class SerializingListener : public ApplicationListener {
     public:
         SerializingListener(model::Game& game,
@@ -18,14 +24,25 @@ namespace app {
         //      
         void LoadState();
 
+        //  ,   
         void SaveNow();
 
     private:
+        void WriteSnapshots(std::stop_token stop);
+
         model::Game& game_;
         std::filesystem::path state_file_;
         std::chrono::milliseconds save_period_;
         std::chrono::milliseconds time_since_last_save_{ 0 };
         state_serializer::StateSerializer serializer_;
+
+        std::mutex mutex_;
+        std::condition_variable_any snapshot_cv_;
+        std::optional<state_serializer::StateSerializer::Snapshot> pending_snapshot_;
+        bool writing_ = false;
+        // :         
+        // ,   ,    
+        std::jthread writer_;
     };
 
 } // namespace app
\ No newline at end of file
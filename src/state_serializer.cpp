@@ -2,25 +2,170 @@
 #include <fstream>
 #include <sstream>
 #include <boost/json.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 namespace state_serializer {
 
     namespace json = boost::json;
+    namespace io = boost::iostreams;
+
+    namespace {
+        constexpr std::string_view SNAPSHOT_MAGIC = "GSSNAP01";
+        constexpr int64_t SNAPSHOT_VERSION = 1;
+        constexpr size_t FOOTER_SIZE = SNAPSHOT_MAGIC.size() + 2 * sizeof(uint64_t);
+
+        void AppendUint64(std::string& out, uint64_t value) {
+            for (size_t i = 0; i < sizeof(value); ++i) {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        uint64_t ReadUint64(const std::string& data, size_t pos) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < sizeof(value); ++i) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+            }
+            return value;
+        }
+
+        bool HasSnapshotFooter(const std::string& data) {
+            return data.size() >= FOOTER_SIZE
+                && std::string_view(data).substr(data.size() - FOOTER_SIZE, SNAPSHOT_MAGIC.size()) == SNAPSHOT_MAGIC;
+        }
+
+        std::string Compress(std::string_view raw) {
+            std::string compressed;
+            {
+                io::filtering_ostream out;
+                out.push(io::zlib_compressor(io::zlib::best_speed));
+                out.push(io::back_inserter(compressed));
+                out.write(raw.data(), static_cast<std::streamsize>(raw.size()));
+            }
+            return compressed;
+        }
+
+        std::string Decompress(std::string_view compressed) {
+            std::string raw;
+            io::filtering_istream in;
+            in.push(io::zlib_decompressor());
+            in.push(io::array_source(compressed.data(), compressed.size()));
+            io::copy(in, io::back_inserter(raw));
+            return raw;
+        }
+
+        // Выполняет fn(0..count-1) на пуле потоков, первое исключение пробрасывается наружу
+        template <typename Fn>
+        void ParallelFor(size_t count, const Fn& fn) {
+            const size_t threads_count = std::min<size_t>(
+                std::max(1u, std::thread::hardware_concurrency()), count);
+
+            std::atomic<size_t> next_idx{ 0 };
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            {
+                std::vector<std::jthread> workers;
+                workers.reserve(threads_count);
+                for (size_t i = 0; i < threads_count; ++i) {
+                    workers.emplace_back([&] {
+                        for (size_t idx; (idx = next_idx++) < count;) {
+                            try {
+                                fn(idx);
+                            }
+                            catch (...) {
+                                std::lock_guard lock(error_mutex);
+                                if (!error) {
+                                    error = std::current_exception();
+                                }
+                            }
+                        }
+                        });
+                }
+            }
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }  // namespace
+
+    StateSerializer::Snapshot StateSerializer::Capture(const model::Game& game) {
+        // Нарезаем сессии на чанки по players_per_chunk_ игроков.
+        // Лут и next_loot_id сессии попадают только в её первый чанк
+        Snapshot snapshot;
+        for (const auto& session : game.GetSessions()) {
+            const size_t players_count = session.GetPlayers().size();
+            size_t first = 0;
+            do {
+                size_t last = std::min(players_count, first + players_per_chunk_);
+                snapshot.chunks.push_back({ *session.GetMap()->GetId(),
+                    json::serialize(SerializeSessionChunk(session, first, last, first == 0)) });
+                first = last;
+            } while (first < players_count);
+        }
+        return snapshot;
+    }
 
     void StateSerializer::Serialize(const model::Game& game, const std::filesystem::path& file_path) {
-        auto game_obj = SerializeGame(game);
+        Write(Capture(game), file_path);
+    }
+
+    void StateSerializer::Write(const Snapshot& snapshot, const std::filesystem::path& file_path) const {
+        // Сжимаем чанки параллельно
+        std::vector<std::string> chunks(snapshot.chunks.size());
+        ParallelFor(chunks.size(), [&](size_t idx) {
+            chunks[idx] = Compress(snapshot.chunks[idx].json);
+            });
 
         // Создаем временный файл для атомарности
         auto temp_path = file_path;
         temp_path += ".tmp";
 
         {
-            std::ofstream file(temp_path);
+            std::ofstream file(temp_path, std::ios::binary);
             if (!file) {
                 throw std::runtime_error("Cannot open state file for writing: " + temp_path.string());
             }
-            file << json::serialize(game_obj);
+
+            json::array index_chunks;
+            uint64_t offset = 0;
+            for (size_t idx = 0; idx < chunks.size(); ++idx) {
+                file.write(chunks[idx].data(), static_cast<std::streamsize>(chunks[idx].size()));
+                index_chunks.push_back({
+                    {"map_id", snapshot.chunks[idx].map_id},
+                    {"offset", offset},
+                    {"size", static_cast<uint64_t>(chunks[idx].size())},
+                    {"raw_size", static_cast<uint64_t>(snapshot.chunks[idx].json.size())}
+                    });
+                offset += chunks[idx].size();
+            }
+
+            json::object index;
+            index["version"] = SNAPSHOT_VERSION;
+            index["chunks"] = std::move(index_chunks);
+            auto index_str = json::serialize(index);
+            file.write(index_str.data(), static_cast<std::streamsize>(index_str.size()));
+
+            // Хвост: сигнатура, смещение и размер индекса
+            std::string footer(SNAPSHOT_MAGIC);
+            AppendUint64(footer, offset);
+            AppendUint64(footer, index_str.size());
+            file.write(footer.data(), static_cast<std::streamsize>(footer.size()));
+
+            if (!file) {
+                throw std::runtime_error("Failed to write state file: " + temp_path.string());
+            }
         }
 
         // Атомарное переименование
@@ -33,22 +178,28 @@ namespace state_serializer {
             return;
         }
 
-        std::ifstream file(file_path);
+        std::ifstream file(file_path, std::ios::binary);
         if (!file) {
             throw std::runtime_error("Cannot open state file for reading: " + file_path.string());
         }
 
         std::stringstream buffer;
         buffer << file.rdbuf();
-        std::string json_str = buffer.str();
+        std::string data = buffer.str();
 
-        if (json_str.empty()) {
+        if (data.empty()) {
             std::cout << "State file is empty, starting with fresh state." << std::endl;
             return;
         }
 
         try {
-            auto value = json::parse(json_str);
+            if (HasSnapshotFooter(data)) {
+                DeserializeChunked(game, data);
+                return;
+            }
+
+            // Старый формат: весь снимок одним JSON-объектом
+            auto value = json::parse(data);
             if (!value.is_object()) {
                 throw std::runtime_error("Invalid state file format: expected object");
             }
@@ -60,6 +211,70 @@ namespace state_serializer {
         }
     }
 
+    void StateSerializer::DeserializeChunked(model::Game& game, const std::string& data) {
+        const size_t footer_pos = data.size() - FOOTER_SIZE;
+        const uint64_t index_offset = ReadUint64(data, footer_pos + SNAPSHOT_MAGIC.size());
+        const uint64_t index_size = ReadUint64(data, footer_pos + SNAPSHOT_MAGIC.size() + sizeof(uint64_t));
+        if (index_offset > footer_pos || index_size != footer_pos - index_offset) {
+            throw std::runtime_error("Invalid snapshot index location");
+        }
+
+        auto index = json::parse(std::string_view(data).substr(index_offset, index_size)).as_object();
+        if (index.at("version").as_int64() != SNAPSHOT_VERSION) {
+            throw std::runtime_error("Unsupported snapshot version");
+        }
+
+        const auto& index_chunks = index.at("chunks").as_array();
+        for (const auto& chunk_val : index_chunks) {
+            const auto& chunk = chunk_val.as_object();
+            if (chunk.at("offset").to_number<uint64_t>() + chunk.at("size").to_number<uint64_t>() > index_offset) {
+                throw std::runtime_error("Snapshot chunk is out of bounds");
+            }
+        }
+
+        // Распаковываем и разбираем чанки параллельно, применяем к игре по порядку
+        std::vector<std::optional<json::object>> sessions(index_chunks.size());
+        ParallelFor(index_chunks.size(), [&](size_t idx) {
+            const auto& chunk = index_chunks[idx].as_object();
+            try {
+                auto raw = Decompress(std::string_view(data).substr(
+                    chunk.at("offset").to_number<uint64_t>(), chunk.at("size").to_number<uint64_t>()));
+                sessions[idx] = json::parse(raw).as_object();
+            }
+            catch (const std::exception& ex) {
+                std::cerr << "Failed to restore snapshot chunk " << idx << ": " << ex.what() << std::endl;
+            }
+            });
+
+        // Сессия восстанавливается только целиком: без первого чанка она потеряет
+        // next_loot_id, и новые предметы получат id уже лежащих в рюкзаках
+        std::unordered_set<std::string> broken_maps;
+        for (size_t idx = 0; idx < sessions.size(); ++idx) {
+            const auto* map_id = index_chunks[idx].as_object().if_contains("map_id");
+            if (!sessions[idx] && map_id && broken_maps.insert(std::string(map_id->as_string())).second) {
+                std::cerr << "Skipping session on map " << map_id->as_string().c_str()
+                    << ": some of its snapshot chunks are damaged" << std::endl;
+            }
+        }
+
+        for (const auto& session_obj : sessions) {
+            if (!session_obj) {
+                continue;
+            }
+            const auto* map_id = session_obj->if_contains("map_id");
+            if (map_id && map_id->is_string() && broken_maps.contains(std::string(map_id->as_string()))) {
+                continue;
+            }
+            try {
+                DeserializeSession(game, *session_obj);
+            }
+            catch (const std::exception& ex) {
+                std::cerr << "Failed to deserialize session: " << ex.what() << std::endl;
+                // Продолжаем с другими чанками
+            }
+        }
+    }
+
     boost::json::object StateSerializer::SerializeGame(const model::Game& game) {
         boost::json::object game_obj;
 
@@ -74,25 +289,35 @@ namespace state_serializer {
     }
 
     boost::json::object StateSerializer::SerializeSession(const model::GameSession& session) {
+        return SerializeSessionChunk(session, 0, session.GetPlayers().size(), true);
+    }
+
+    boost::json::object StateSerializer::SerializeSessionChunk(const model::GameSession& session,
+        size_t first_player, size_t last_player, bool with_loots) {
         boost::json::object session_obj;
 
         session_obj["id"] = *session.GetId();
         session_obj["map_id"] = *session.GetMap()->GetId();
-        session_obj["next_loot_id"] = session.GetNextLootId();
 
         // Сериализуем игроков
+        const auto& players = session.GetPlayers();
         json::array players_array;
-        for (const auto& player : session.GetPlayers()) {
-            players_array.push_back(SerializePlayer(player));
+        players_array.reserve(last_player - first_player);
+        for (size_t idx = first_player; idx < last_player; ++idx) {
+            players_array.push_back(SerializePlayer(players[idx]));
         }
         session_obj["players"] = std::move(players_array);
 
-        // Сериализуем лут
-        json::array loot_array;
-        for (const auto& loot : session.GetLoots()) {
-            loot_array.push_back(SerializeLoot(loot));
+        if (with_loots) {
+            session_obj["next_loot_id"] = session.GetNextLootId();
+
+            // Сериализуем лут
+            json::array loot_array;
+            for (const auto& loot : session.GetLoots()) {
+                loot_array.push_back(SerializeLoot(loot));
+            }
+            session_obj["loots"] = std::move(loot_array);
         }
-        session_obj["loots"] = std::move(loot_array);
 
         return session_obj;
     }
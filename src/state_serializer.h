@@ -4,17 +4,46 @@
 #include <boost/json.hpp>
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <string>
+#include <vector>
 
 namespace state_serializer {
 
+    //  :   zlib  (    ),
+    //   JSON-        .
+    //     
     class StateSerializer {
     public:
+        static constexpr size_t DEFAULT_PLAYERS_PER_CHUNK = 4096;
+
+        //   .  ,   ,  
+        //         ,    
+        struct Snapshot {
+            struct Chunk {
+                std::string map_id;
+                std::string json;
+            };
+            std::vector<Chunk> chunks;
+        };
+
+        Snapshot Capture(const model::Game& game);
+        void Write(const Snapshot& snapshot, const std::filesystem::path& file_path) const;
+        // Capture  Write 
         void Serialize(const model::Game& game, const std::filesystem::path& file_path);
+        //    ,       JSON-
         void Deserialize(model::Game& game, const std::filesystem::path& file_path);
 
+        void SetPlayersPerChunk(size_t players_per_chunk) noexcept {
+            players_per_chunk_ = std::max<size_t>(1, players_per_chunk);
+        }
+
         //     
         boost::json::object SerializeGame(const model::Game& game);
         boost::json::object SerializeSession(const model::GameSession& session);
+        //  :  [first_player, last_player) ,  with_loots,   next_loot_id
+        boost::json::object SerializeSessionChunk(const model::GameSession& session,
+            size_t first_player, size_t last_player, bool with_loots);
         boost::json::object SerializePlayer(const model::Player& player);
         boost::json::object SerializeDog(const model::Dog& dog);
         boost::json::object SerializeLoot(const geom::Loot& loot);
@@ -27,6 +56,11 @@ namespace state_serializer {
         model::Dog DeserializeDog(const boost::json::object& json_val);
         geom::Loot DeserializeLoot(const boost::json::object& json_val);
         Token DeserializeToken(const std::string& token_str);
+
+    private:
+        void DeserializeChunked(model::Game& game, const std::string& data);
+
+        size_t players_per_chunk_ = DEFAULT_PLAYERS_PER_CHUNK;
     };
 
 } // namespace state_serializer
\ No newline at end of file
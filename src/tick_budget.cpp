@@ -0,0 +1,51 @@
+#include "tick_budget.h"
+
+namespace model {
+
+    std::string_view DegradationLevelToString(DegradationLevel level) noexcept {
+        switch (level) {
+        case DegradationLevel::NONE: return "none";
+        case DegradationLevel::DEFER_LOOT: return "deferLoot";
+        case DegradationLevel::THROTTLE_PUBLICATION: return "throttlePublication";
+        case DegradationLevel::POSTPONE_PERSISTENCE: return "postponePersistence";
+        }
+        return "unknown";
+    }
+
+    bool TickBudget::OnTick(Clock::duration cost, Clock::duration period) noexcept {
+        if (period <= Clock::duration::zero()) {
+            return false;
+        }
+
+        const double sample = std::chrono::duration<double>(cost) / std::chrono::duration<double>(period);
+        const double load = load_.load(std::memory_order_relaxed) * (1.0 - SMOOTHING) + sample * SMOOTHING;
+        load_.store(load, std::memory_order_relaxed);
+
+        over_ticks_ = load > HIGH_WATERMARK ? over_ticks_ + 1 : 0;
+        under_ticks_ = load < LOW_WATERMARK ? under_ticks_ + 1 : 0;
+
+        const int level = level_.load(std::memory_order_relaxed);
+        constexpr int max_level = static_cast<int>(DegradationLevel::POSTPONE_PERSISTENCE);
+
+        if (over_ticks_ >= RAISE_AFTER_TICKS && level < max_level) {
+            // Даём следующей ступени время подействовать, прежде чем поднимать снова
+            over_ticks_ = 0;
+            level_.store(level + 1, std::memory_order_relaxed);
+            return true;
+        }
+        if (under_ticks_ >= LOWER_AFTER_TICKS && level > 0) {
+            under_ticks_ = 0;
+            level_.store(level - 1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void TickBudget::Reset() noexcept {
+        level_.store(static_cast<int>(DegradationLevel::NONE), std::memory_order_relaxed);
+        load_.store(0.0, std::memory_order_relaxed);
+        over_ticks_ = 0;
+        under_ticks_ = 0;
+    }
+
+}  // namespace model
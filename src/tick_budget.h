@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string_view>
+
+namespace model {
+
+    // Уровни деградации некритичной работы. Каждый следующий уровень включает предыдущие.
+    // Движение собак и сбор предметов не деградируют никогда
+    enum class DegradationLevel : int {
+        NONE = 0,
+        // Лут генерируется реже, пропущенное время копится и учитывается позже
+        DEFER_LOOT = 1,
+        // Состояние сессии отдаётся клиентам из кэша, а не собирается на каждый запрос
+        THROTTLE_PUBLICATION = 2,
+        // Автосохранение откладывается
+        POSTPONE_PERSISTENCE = 3
+    };
+
+    std::string_view DegradationLevelToString(DegradationLevel level) noexcept;
+
+    // Следит за стоимостью тика относительно его периода и выбирает уровень деградации.
+    // Уровень поднимается на одну ступень, когда сглаженная нагрузка несколько тиков подряд
+    // выше верхней отметки, и опускается после долгого запаса ниже нижней
+    class TickBudget {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr double SMOOTHING = 0.2;
+        static constexpr double HIGH_WATERMARK = 0.8;
+        static constexpr double LOW_WATERMARK = 0.5;
+        static constexpr int RAISE_AFTER_TICKS = 3;
+        static constexpr int LOWER_AFTER_TICKS = 20;
+
+        // Параметры деградаций
+        static constexpr double DEFERRED_LOOT_INTERVAL = 1.0;
+        static constexpr std::chrono::milliseconds DEGRADED_PUBLICATION_INTERVAL{ 250 };
+        static constexpr int MAX_PERSISTENCE_POSTPONE = 4;
+
+        // Учитывает очередной тик. Возвращает true, если уровень деградации изменился
+        bool OnTick(Clock::duration cost, Clock::duration period) noexcept;
+
+        DegradationLevel GetLevel() const noexcept {
+            return static_cast<DegradationLevel>(level_.load(std::memory_order_relaxed));
+        }
+
+        bool IsDegraded(DegradationLevel level) const noexcept {
+            return GetLevel() >= level;
+        }
+
+        // Сглаженная доля периода, которую занимает тик
+        double GetLoad() const noexcept {
+            return load_.load(std::memory_order_relaxed);
+        }
+
+        void Reset() noexcept;
+
+    private:
+        std::atomic<int> level_{ static_cast<int>(DegradationLevel::NONE) };
+        std::atomic<double> load_{ 0.0 };
+        int over_ticks_ = 0;
+        int under_ticks_ = 0;
+    };
+
+}  // namespace model
@@ -160,6 +160,8 @@ class GameState {
     this.keyState = new KeyState();
     this.currentState = {players: {}};
     this.requestInstantUpdate = false;
+    this.longPoll = false;
+    this.lastTick = undefined;
     this.cameraPos = undefined;
     this.lostObjects = {};
     this.disappearingLoot = {};
@@ -183,7 +185,8 @@ class GameState {
     if (!this.started)
       return false;
 
-    if ((this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress) {
+    const periodicUpdate = !this.longPoll && this.ticks % this.posUpdateInterval == 0;
+    if ((periodicUpdate || this.requestInstantUpdate) && !this.updateInProgress) {
       this.requestInstantUpdate = false;
       this._updateState(function() {
         self._applyDesiredState();
@@ -237,6 +240,12 @@ class GameState {
     this._applyDesiredState();
     this._instantApplyState();
 
+    // Server reports tick numbers: wait for each new tick instead of polling on a timer
+    if (this.lastTick !== undefined) {
+      this.longPoll = true;
+      this._pollState();
+    }
+
     if (this.desiredState.players[playerId] !== undefined) {
       const thisPlayer = this.desiredState.players[playerId];
       this.cameraPos = thisPlayer.pos;
@@ -418,12 +427,41 @@ class GameState {
         xhr.setRequestHeader("Authorization", "Bearer " + Cookies.get('authToken'));
       }
     }).done(function(x){
-      self.desiredState = x;
-      self.stateTime = performance.now();
+      // A plain request may finish after a long-poll that already delivered a newer tick
+      if (x.tick !== undefined && self.lastTick !== undefined && x.tick < self.lastTick) {
+        return;
+      }
+      self._setDesiredState(x);
       then();
     })
   }
 
+  _setDesiredState(x) {
+    this.desiredState = x;
+    this.stateTime = performance.now();
+    if (x.tick !== undefined) {
+      this.lastTick = x.tick;
+    }
+  }
+
+  _pollState() {
+    let self = this;
+    $.get({
+      url: '/api/v1/game/state?afterTick=' + this.lastTick,
+      dataType: 'json',
+      beforeSend: function(xhr) {
+        xhr.setRequestHeader("Authorization", "Bearer " + Cookies.get('authToken'));
+      }
+    }).done(function(x){
+      // Long-poll responses come one at a time; an older tick here means the server restarted
+      self._setDesiredState(x);
+      self._applyDesiredState();
+      self._pollState();
+    }).fail(function() {
+      setTimeout(function() { self._pollState(); }, 1000);
+    })
+  }
+
   _interpolateRotation(old_pos, new_pos) {
     const pi = Math.PI;
     const rot_speed = pi / 300;
@@ -397,4 +397,68 @@ TEST_CASE("Item not collected when widths sum less than distance") {
     CHECK(events.empty());
 }
 
+TEST_CASE("Static item index finds items along the line of movement") {
+    // Горизонтальная линия y = 0 и вертикальная x = 10
+    StaticItemIndex index({Item{{5, 0.3}, 0.5}, Item{{8, 0}, 0.5}, Item{{10, 5}, 0.5}},
+                          {{true, 0.0}, {false, 10.0}}, 0.6, 0.4);
+
+    std::vector<GatheringEvent> events;
+    index.FindEvents(0, Gatherer{{0, 0}, {10, 0}, 0.6}, events);
+    REQUIRE(events.size() == 2);
+    std::sort(events.begin(), events.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.time < rhs.time;
+    });
+    CHECK(events[0].item_id == 0);
+    CHECK_THAT(events[0].time, Catch::Matchers::WithinAbs(0.5, 1e-9));
+    CHECK_THAT(events[0].sq_distance, Catch::Matchers::WithinAbs(0.09, 1e-9));
+    CHECK(events[1].item_id == 1);
+    CHECK_THAT(events[1].time, Catch::Matchers::WithinAbs(0.8, 1e-9));
+
+    events.clear();
+    index.FindEvents(3, Gatherer{{10.2, 8}, {10.2, 2}, 0.6}, events);
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].item_id == 2);
+    CHECK(events[0].gatherer_id == 3);
+    CHECK_THAT(events[0].time, Catch::Matchers::WithinAbs(0.5, 1e-9));
+}
+
+TEST_CASE("Static item index matches brute force search") {
+    std::vector<Item> items;
+    for (int i = 0; i < 20; ++i) {
+        items.push_back(Item{{i * 1.7 - 3.0, (i % 5) * 0.35 - 0.7}, 0.5});
+        items.push_back(Item{{(i % 4) * 0.25 + 9.6, i * 1.3 - 4.0}, 0.5});
+    }
+    StaticItemIndex index(items, {{true, 0.0}, {false, 10.0}}, 0.6, 0.4);
+
+    const std::vector<Gatherer> gatherers{
+        {{-4, 0.4}, {30, 0.4}, 0.6},
+        {{25, -0.4}, {1, -0.4}, 0.6},
+        {{10.4, -5}, {10.4, 20}, 0.6},
+        {{9.6, 18}, {9.6, 3}, 0.6},
+        // Вне линий и по диагонали - полный перебор
+        {{0, 5}, {10, 5}, 0.6},
+        {{0, 0}, {10, 10}, 0.6},
+    };
+
+    for (size_t gatherer_id = 0; gatherer_id < gatherers.size(); ++gatherer_id) {
+        std::vector<GatheringEvent> events;
+        index.FindEvents(gatherer_id, gatherers[gatherer_id], events);
+        auto expected = FindGatherEvents(TestProvider(items, {gatherers[gatherer_id]}));
+
+        auto by_item = [](const GatheringEvent& lhs, const GatheringEvent& rhs) {
+            return lhs.item_id < rhs.item_id;
+        };
+        std::sort(events.begin(), events.end(), by_item);
+        std::sort(expected.begin(), expected.end(), by_item);
+
+        REQUIRE(events.size() == expected.size());
+        for (size_t i = 0; i < events.size(); ++i) {
+            CHECK(events[i].item_id == expected[i].item_id);
+            CHECK(events[i].gatherer_id == gatherer_id);
+            CHECK_THAT(events[i].time, Catch::Matchers::WithinAbs(expected[i].time, 1e-9));
+            CHECK_THAT(events[i].sq_distance, Catch::Matchers::WithinAbs(expected[i].sq_distance, 1e-9));
+        }
+    }
+}
+
 }  // namespace collision_detector
\ No newline at end of file
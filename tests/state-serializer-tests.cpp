@@ -0,0 +1,136 @@
+#include "../src/state_serializer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <boost/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace std::literals;
+
+namespace {
+
+namespace fs = std::filesystem;
+
+const model::Map::Id MAP_ID{"map1"s};
+const model::Map::Id OTHER_MAP_ID{"map2"s};
+
+void AddMaps(model::Game& game) {
+    game.AddMap(model::Map{MAP_ID, "Map 1"s});
+    game.AddMap(model::Map{OTHER_MAP_ID, "Map 2"s});
+}
+
+void FillGame(model::Game& game) {
+    auto& session = game.GetOrCreateSession(MAP_ID);
+    for (size_t i = 0; i < 3; ++i) {
+        model::Dog dog{model::Dog::Id{"dog"s + std::to_string(i)}, "Dog "s + std::to_string(i), MAP_ID};
+        dog.SetPosition({1.5 * i, 2.0});
+        model::Player player{model::Player::Id{i}, std::move(dog),
+            Token{std::string(31, '0') + std::to_string(i)}, 3};
+        player.AddScore(static_cast<int>(10 * i));
+        session.AddPlayer(std::move(player));
+    }
+    session.AddLoot(geom::Loot{geom::Loot::Id{7}, 1, {3.0, 4.0}, 20});
+    session.AddLoot(geom::Loot{geom::Loot::Id{8}, 0, {5.0, 6.0}, 10});
+    session.SetNextLootId(9);
+
+    // Сессия без игроков тоже должна пережить сохранение
+    game.GetOrCreateSession(OTHER_MAP_ID);
+}
+
+void CheckRestored(const model::Game& game) {
+    REQUIRE(game.GetSessions().size() == 2);
+    const auto& session = game.GetSessions().front();
+    CHECK(session.GetMap()->GetId() == MAP_ID);
+    CHECK(session.GetNextLootId() == 9);
+
+    const auto& players = session.GetPlayers();
+    REQUIRE(players.size() == 3);
+    for (size_t i = 0; i < players.size(); ++i) {
+        CHECK(*players[i].GetId() == i);
+        CHECK(*players[i].GetToken() == std::string(31, '0') + std::to_string(i));
+        CHECK(players[i].GetScore() == static_cast<int>(10 * i));
+        CHECK(players[i].GetDog().GetPosition().x == 1.5 * i);
+    }
+
+    // Лут хранится только в первом чанке сессии и не дублируется
+    const auto& loots = session.GetLoots();
+    REQUIRE(loots.size() == 2);
+    CHECK(*loots[0].id == 7);
+    CHECK(loots[0].value == 20);
+    CHECK(*loots[1].id == 8);
+
+    CHECK(game.GetSessions().back().GetMap()->GetId() == OTHER_MAP_ID);
+    CHECK(game.GetSessions().back().GetPlayers().empty());
+}
+
+struct TempFile {
+    fs::path path = fs::temp_directory_path() / "state-serializer-tests.state";
+
+    ~TempFile() {
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+};
+
+// Портит первый чанк снимка, не трогая индекс и хвост
+void DamageFirstChunk(const fs::path& path) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(0);
+    file.write("garbage!", 8);
+}
+
+}  // namespace
+
+TEST_CASE("Chunked snapshot round trip with one player per chunk") {
+    model::Game game;
+    AddMaps(game);
+    FillGame(game);
+
+    TempFile file;
+    state_serializer::StateSerializer serializer;
+    serializer.SetPlayersPerChunk(1);
+    serializer.Serialize(game, file.path);
+
+    model::Game restored;
+    AddMaps(restored);
+    state_serializer::StateSerializer{}.Deserialize(restored, file.path);
+    CheckRestored(restored);
+}
+
+TEST_CASE("Legacy single-object JSON snapshot is still readable") {
+    model::Game game;
+    AddMaps(game);
+    FillGame(game);
+
+    TempFile file;
+    state_serializer::StateSerializer serializer;
+    {
+        std::ofstream out(file.path, std::ios::binary);
+        out << boost::json::serialize(serializer.SerializeGame(game));
+    }
+
+    model::Game restored;
+    AddMaps(restored);
+    serializer.Deserialize(restored, file.path);
+    CheckRestored(restored);
+}
+
+TEST_CASE("Session with a damaged chunk is skipped as a whole") {
+    model::Game game;
+    AddMaps(game);
+    FillGame(game);
+
+    TempFile file;
+    state_serializer::StateSerializer serializer;
+    serializer.SetPlayersPerChunk(1);
+    serializer.Serialize(game, file.path);
+    DamageFirstChunk(file.path);
+
+    // Без первого чанка сессия потеряла бы лут и next_loot_id,
+    // поэтому её остальные чанки тоже не применяются
+    model::Game restored;
+    AddMaps(restored);
+    state_serializer::StateSerializer{}.Deserialize(restored, file.path);
+    REQUIRE(restored.GetSessions().size() == 1);
+    CHECK(restored.GetSessions().front().GetMap()->GetId() == OTHER_MAP_ID);
+}